@@ -0,0 +1,95 @@
+#include "BRDFs.h"
+
+#include "SIMD.h"
+
+namespace dae
+{
+	namespace BRDF
+	{
+		static void CookTorrance_Scalar(const CookTorranceConstants& constants, const ShadingBatch& batch, uint32_t first, ColorRGB* pColors)
+		{
+			for (uint32_t i{ first }; i < batch.count; ++i)
+			{
+				pColors[i] = CookTorrance(constants, batch.GetNormal(i), batch.GetLightDirection(i), batch.GetViewDirection(i));
+			}
+		}
+
+#if defined(SIMD_X86)
+		SIMD_TARGET_AVX2
+		static __m256 DotClamp_AVX2(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+		{
+			const __m256 dot{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_mul_ps(az, bz)) };
+			return _mm256_max_ps(dot, _mm256_setzero_ps());
+		}
+
+		// Lane by lane the same operations as the scalar version, returns the number of samples it shaded (a multiple of 8)
+		SIMD_TARGET_AVX2
+		static uint32_t CookTorrance_AVX2(const CookTorranceConstants& constants, const ShadingBatch& batch, ColorRGB* pColors)
+		{
+			const __m256 signBit{ _mm256_set1_ps(-0.f) }, one{ _mm256_set1_ps(1.f) }, four{ _mm256_set1_ps(4.f) };
+			const __m256 minimumDenominator{ _mm256_set1_ps(0.000001f) };
+			const __m256 alphaSquaredOverPi{ _mm256_set1_ps(constants.alphaSquaredOverPi) };
+			const __m256 alphaSquaredMinusOne{ _mm256_set1_ps(constants.alphaSquaredMinusOne) };
+			const __m256 k{ _mm256_set1_ps(constants.k) }, oneMinusK{ _mm256_set1_ps(constants.oneMinusK) };
+			const __m256 f0[3]{ _mm256_set1_ps(constants.f0.r), _mm256_set1_ps(constants.f0.g), _mm256_set1_ps(constants.f0.b) };
+			const __m256 oneMinusF0[3]{ _mm256_set1_ps(constants.oneMinusF0.r), _mm256_set1_ps(constants.oneMinusF0.g), _mm256_set1_ps(constants.oneMinusF0.b) };
+			const __m256 diffuseColor[3]{ _mm256_set1_ps(constants.diffuseColor.r), _mm256_set1_ps(constants.diffuseColor.g), _mm256_set1_ps(constants.diffuseColor.b) };
+
+			const uint32_t nrFullSteps{ batch.count / 8 * 8 };
+			for (uint32_t first{ 0 }; first < nrFullSteps; first += 8)
+			{
+				const __m256 nx{ _mm256_load_ps(batch.normalX + first) }, ny{ _mm256_load_ps(batch.normalY + first) }, nz{ _mm256_load_ps(batch.normalZ + first) };
+				const __m256 lx{ _mm256_load_ps(batch.lightX + first) }, ly{ _mm256_load_ps(batch.lightY + first) }, lz{ _mm256_load_ps(batch.lightZ + first) };
+				// Flip the view direction so it points towards the eye
+				const __m256 vx{ _mm256_xor_ps(_mm256_load_ps(batch.viewX + first), signBit) };
+				const __m256 vy{ _mm256_xor_ps(_mm256_load_ps(batch.viewY + first), signBit) };
+				const __m256 vz{ _mm256_xor_ps(_mm256_load_ps(batch.viewZ + first), signBit) };
+
+				const __m256 hx{ _mm256_add_ps(vx, lx) }, hy{ _mm256_add_ps(vy, ly) }, hz{ _mm256_add_ps(vz, lz) };
+				const __m256 halfVectorLength{ _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(hx, hx), _mm256_mul_ps(hy, hy)), _mm256_mul_ps(hz, hz))) };
+				const __m256 nhx{ _mm256_div_ps(hx, halfVectorLength) }, nhy{ _mm256_div_ps(hy, halfVectorLength) }, nhz{ _mm256_div_ps(hz, halfVectorLength) };
+
+				const __m256 nDotV{ DotClamp_AVX2(nx, ny, nz, vx, vy, vz) };
+				const __m256 nDotL{ DotClamp_AVX2(nx, ny, nz, lx, ly, lz) };
+				const __m256 nDotH{ DotClamp_AVX2(nx, ny, nz, nhx, nhy, nhz) };
+				const __m256 hDotV{ DotClamp_AVX2(nhx, nhy, nhz, vx, vy, vz) };
+
+				const __m256 oneMinusHDotV{ _mm256_sub_ps(one, hDotV) };
+				const __m256 oneMinusHDotVSquared{ _mm256_mul_ps(oneMinusHDotV, oneMinusHDotV) };
+				const __m256 fresnelWeight{ _mm256_mul_ps(_mm256_mul_ps(oneMinusHDotVSquared, oneMinusHDotVSquared), oneMinusHDotV) };
+
+				const __m256 distributionDenominator{ _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(nDotH, nDotH), alphaSquaredMinusOne), one) };
+				const __m256 distribution{ _mm256_div_ps(alphaSquaredOverPi, _mm256_mul_ps(distributionDenominator, distributionDenominator)) };
+				const __m256 geometryV{ _mm256_div_ps(nDotV, _mm256_add_ps(_mm256_mul_ps(nDotV, oneMinusK), k)) };
+				const __m256 geometryL{ _mm256_div_ps(nDotL, _mm256_add_ps(_mm256_mul_ps(nDotL, oneMinusK), k)) };
+				// Operands swapped compared to std::max so a NaN denominator propagates the same way
+				const __m256 specularDenominator{ _mm256_max_ps(minimumDenominator, _mm256_mul_ps(_mm256_mul_ps(four, nDotV), nDotL)) };
+				const __m256 specular{ _mm256_div_ps(_mm256_mul_ps(distribution, _mm256_mul_ps(geometryV, geometryL)), specularDenominator) };
+
+				alignas(32) float channels[3][8];
+				for (int channel{ 0 }; channel < 3; ++channel)
+				{
+					const __m256 fresnel{ _mm256_add_ps(f0[channel], _mm256_mul_ps(oneMinusF0[channel], fresnelWeight)) };
+					const __m256 color{ _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(one, fresnel), diffuseColor[channel]), _mm256_mul_ps(fresnel, specular)) };
+					_mm256_store_ps(channels[channel], color);
+				}
+				for (uint32_t lane{ 0 }; lane < 8; ++lane)
+				{
+					pColors[first + lane] = { channels[0][lane], channels[1][lane], channels[2][lane] };
+				}
+			}
+			return nrFullSteps;
+		}
+#endif
+
+		void CookTorrance(const CookTorranceConstants& constants, const ShadingBatch& batch, ColorRGB* pColors)
+		{
+			uint32_t first{ 0 };
+#if defined(SIMD_X86)
+			if (SIMD::GetSIMDLevel() == SIMDLevel::AVX2) first = CookTorrance_AVX2(constants, batch, pColors);
+#endif
+			// The samples that do not fill 8 lanes
+			CookTorrance_Scalar(constants, batch, first, pColors);
+		}
+	}
+}
\ No newline at end of file
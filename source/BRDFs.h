@@ -1,9 +1,51 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
 #include "Math.h"
 
 namespace dae
 {
+	// Enough for every lit ray of one tile
+	constexpr uint32_t g_ShadingBatchSize{ 64 };
+
+	/**
+	 * \brief Shading points that share one material, the renderer gathers them so the material is looked up once per batch
+	 * Stored per component so the batch kernels load 8 lanes at once, the first count entries are valid
+	 */
+	struct alignas(32) ShadingBatch
+	{
+		float normalX[g_ShadingBatchSize];
+		float normalY[g_ShadingBatchSize];
+		float normalZ[g_ShadingBatchSize];
+		float lightX[g_ShadingBatchSize];
+		float lightY[g_ShadingBatchSize];
+		float lightZ[g_ShadingBatchSize];
+		// From the eye to the surface, like the camera rays
+		float viewX[g_ShadingBatchSize];
+		float viewY[g_ShadingBatchSize];
+		float viewZ[g_ShadingBatchSize];
+		uint32_t count{};
+
+		void Add(const Vector3& normal, const Vector3& lightDirection, const Vector3& viewDirection)
+		{
+			assert(count < g_ShadingBatchSize);
+			normalX[count] = normal.x;
+			normalY[count] = normal.y;
+			normalZ[count] = normal.z;
+			lightX[count] = lightDirection.x;
+			lightY[count] = lightDirection.y;
+			lightZ[count] = lightDirection.z;
+			viewX[count] = viewDirection.x;
+			viewY[count] = viewDirection.y;
+			viewZ[count] = viewDirection.z;
+			++count;
+		}
+
+		Vector3 GetNormal(uint32_t index) const { return { normalX[index], normalY[index], normalZ[index] }; }
+		Vector3 GetLightDirection(uint32_t index) const { return { lightX[index], lightY[index], lightZ[index] }; }
+		Vector3 GetViewDirection(uint32_t index) const { return { viewX[index], viewY[index], viewZ[index] }; }
+	};
+
 	namespace BRDF
 	{
 		/**
@@ -112,5 +154,76 @@ namespace dae
 			return ggx1 * ggx2;
 		}
 
+		/**
+		 * \brief Everything of a Cook-Torrance material that does not depend on the directions, computed once per material
+		 */
+		struct CookTorranceConstants
+		{
+			ColorRGB f0{};
+			ColorRGB oneMinusF0{};
+			// Albedo / PI for dielectrics, black for metals since they have no diffuse term
+			ColorRGB diffuseColor{};
+			// GGX (UE4 remapping, alpha = roughness^2)
+			float alphaSquaredOverPi{};
+			float alphaSquaredMinusOne{};
+			// Schlick-GGX for direct lighting
+			float k{};
+			float oneMinusK{};
+
+			CookTorranceConstants(const ColorRGB& albedo, float metalness, float roughness)
+			{
+				const bool isMetal{ metalness > FLT_EPSILON };
+				f0 = isMetal ? albedo : ColorRGB{ 0.04f, 0.04f, 0.04f };
+				oneMinusF0 = ColorRGB{ 1, 1, 1 } - f0;
+				diffuseColor = isMetal ? ColorRGB{} : ColorRGB{ albedo.r / PI, albedo.g / PI, albedo.b / PI };
+
+				const float alpha{ roughness * roughness };
+				const float alphaSquared{ alpha * alpha };
+				alphaSquaredOverPi = alphaSquared / PI;
+				alphaSquaredMinusOne = alphaSquared - 1;
+				k = Square(alpha + 1) / 8.0f;
+				oneMinusK = 1 - k;
+			}
+		};
+
+		/**
+		 * \brief BRDF Cook-Torrance (GGX * Schlick * Smith) with a Lambert diffuse term weighted by (1 - fresnel)
+		 * The half vector and every dot product are computed once, same operations in the same order as the batch kernels
+		 * \param n Normal of the surface
+		 * \param l Normalized light direction
+		 * \param v Normalized view direction, from the eye to the surface
+		 * \return Cook-Torrance BRDF
+		 */
+		inline ColorRGB CookTorrance(const CookTorranceConstants& constants, const Vector3& n, const Vector3& l, const Vector3& v)
+		{
+			const Vector3 toView{ -v };
+			const Vector3 halfVector{ toView + l };
+			const Vector3 h{ halfVector / halfVector.Magnitude() };
+
+			const float nDotV{ Vector3::DotClamp(n, toView) };
+			const float nDotL{ Vector3::DotClamp(n, l) };
+			const float nDotH{ Vector3::DotClamp(n, h) };
+			const float hDotV{ Vector3::DotClamp(h, toView) };
+
+			const float oneMinusHDotV{ 1 - hDotV };
+			const float oneMinusHDotVSquared{ oneMinusHDotV * oneMinusHDotV };
+			const float fresnelWeight{ oneMinusHDotVSquared * oneMinusHDotVSquared * oneMinusHDotV };
+			const ColorRGB fresnel{ constants.f0 + constants.oneMinusF0 * fresnelWeight };
+
+			const float distributionDenominator{ nDotH * nDotH * constants.alphaSquaredMinusOne + 1 };
+			const float distribution{ constants.alphaSquaredOverPi / (distributionDenominator * distributionDenominator) };
+			const float geometry{ (nDotV / (nDotV * constants.oneMinusK + constants.k)) * (nDotL / (nDotL * constants.oneMinusK + constants.k)) };
+			const float specular{ distribution * geometry / std::max(4 * nDotV * nDotL, 0.000001f) };
+
+			return {
+				(1 - fresnel.r) * constants.diffuseColor.r + fresnel.r * specular,
+				(1 - fresnel.g) * constants.diffuseColor.g + fresnel.g * specular,
+				(1 - fresnel.b) * constants.diffuseColor.b + fresnel.b * specular
+			};
+		}
+
+		// Whole batch at once, 8 lanes per step with AVX2 when the CPU has it
+		void CookTorrance(const CookTorranceConstants& constants, const ShadingBatch& batch, ColorRGB* pColors);
+
 	}
 }
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace dae
+{
+	void BVH::Build(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds, const std::vector<Vector3>& centroids, uint32_t blockSize)
+	{
+		Clear();
+		leafBlockSize = std::max(1u, blockSize);
+
+		const uint32_t nrPrimitives{ static_cast<uint32_t>(centroids.size()) };
+		if (nrPrimitives == 0) return;
+
+		primitiveIndices.resize(nrPrimitives);
+		for (uint32_t i{ 0 }; i < nrPrimitives; ++i)
+		{
+			primitiveIndices[i] = i;
+		}
+
+		// A binary tree with N leaves never has more than 2N - 1 nodes
+		nodes.reserve(2 * static_cast<size_t>(nrPrimitives) - 1);
+
+		BVHNode root{};
+		root.leftFirst = 0;
+		root.primitiveCount = nrPrimitives;
+		nodes.push_back(root);
+
+		UpdateNodeBounds(0, minBounds, maxBounds);
+		Subdivide(0, 0, minBounds, maxBounds, centroids);
+
+		buildCost = CalculateSAHCost();
+	}
+
+	void BVH::BuildFromTriangles(const std::vector<Vector3>& positions, const std::vector<int>& indices, uint32_t blockSize)
+	{
+		const size_t nrTriangles{ indices.size() / 3 };
+
+		std::vector<Vector3> minBounds(nrTriangles);
+		std::vector<Vector3> maxBounds(nrTriangles);
+		std::vector<Vector3> centroids(nrTriangles);
+		for (size_t i{ 0 }; i < nrTriangles; ++i)
+		{
+			const Vector3& v0{ positions[indices[i * 3]] };
+			const Vector3& v1{ positions[indices[i * 3 + 1]] };
+			const Vector3& v2{ positions[indices[i * 3 + 2]] };
+
+			minBounds[i] = Vector3::Min(v0, Vector3::Min(v1, v2));
+			maxBounds[i] = Vector3::Max(v0, Vector3::Max(v1, v2));
+			centroids[i] = (v0 + v1 + v2) / 3.f;
+		}
+
+		Build(minBounds, maxBounds, centroids, blockSize);
+	}
+
+	void BVH::Refit(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds)
+	{
+		// Children are always stored after their parent, so walking backwards visits them first
+		for (int i{ static_cast<int>(nodes.size()) - 1 }; i >= 0; --i)
+		{
+			BVHNode& node{ nodes[i] };
+			if (node.IsLeaf())
+			{
+				UpdateNodeBounds(i, minBounds, maxBounds);
+				continue;
+			}
+
+			const BVHNode& leftChild{ nodes[node.leftFirst] };
+			const BVHNode& rightChild{ nodes[node.leftFirst + 1] };
+			node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+			node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+		}
+	}
+
+	void BVH::RefitFromTriangles(const std::vector<Vector3>& positions, const std::vector<int>& indices)
+	{
+		for (int i{ static_cast<int>(nodes.size()) - 1 }; i >= 0; --i)
+		{
+			BVHNode& node{ nodes[i] };
+			if (node.IsLeaf())
+			{
+				node.minAABB = { FLT_MAX, FLT_MAX, FLT_MAX };
+				node.maxAABB = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+				for (uint32_t p{ 0 }; p < node.primitiveCount; ++p)
+				{
+					const size_t index{ static_cast<size_t>(primitiveIndices[node.leftFirst + p]) * 3 };
+					for (size_t v{ 0 }; v < 3; ++v)
+					{
+						node.minAABB = Vector3::Min(node.minAABB, positions[indices[index + v]]);
+						node.maxAABB = Vector3::Max(node.maxAABB, positions[indices[index + v]]);
+					}
+				}
+				continue;
+			}
+
+			const BVHNode& leftChild{ nodes[node.leftFirst] };
+			const BVHNode& rightChild{ nodes[node.leftFirst + 1] };
+			node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+			node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+		}
+	}
+
+	float BVH::CalculateSAHCost() const
+	{
+		if (nodes.empty()) return 0.f;
+
+		const float rootArea{ SurfaceArea(nodes[0].minAABB, nodes[0].maxAABB) };
+		if (rootArea <= 0.f) return 0.f;
+
+		float cost{};
+		for (const BVHNode& node : nodes)
+		{
+			const float area{ SurfaceArea(node.minAABB, node.maxAABB) };
+			cost += node.IsLeaf() ? area * LeafCost(node.primitiveCount) : area * m_TraversalCost;
+		}
+		return cost / rootArea;
+	}
+
+	bool BVH::NeedsRebuild(float threshold) const
+	{
+		return nodes.empty() || CalculateSAHCost() > buildCost * threshold;
+	}
+
+	void BVH::Clear()
+	{
+		nodes.clear();
+		primitiveIndices.clear();
+		buildCost = 0.f;
+	}
+
+	float BVH::LeafCost(uint32_t primitiveCount) const
+	{
+		// A partially filled block costs as much as a full one
+		const uint32_t nrBlocks{ (primitiveCount + leafBlockSize - 1) / leafBlockSize };
+		return nrBlocks * m_IntersectionCost;
+	}
+
+	void BVH::UpdateNodeBounds(uint32_t nodeIndex, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds)
+	{
+		BVHNode& node{ nodes[nodeIndex] };
+		node.minAABB = { FLT_MAX, FLT_MAX, FLT_MAX };
+		node.maxAABB = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+		{
+			const uint32_t primitiveIndex{ primitiveIndices[node.leftFirst + i] };
+			node.minAABB = Vector3::Min(node.minAABB, minBounds[primitiveIndex]);
+			node.maxAABB = Vector3::Max(node.maxAABB, maxBounds[primitiveIndex]);
+		}
+	}
+
+	float BVH::FindBestSplit(const BVHNode& node, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds, const std::vector<Vector3>& centroids, int& axis, float& splitPosition) const
+	{
+		struct Bin
+		{
+			Vector3 minAABB{ FLT_MAX, FLT_MAX, FLT_MAX };
+			Vector3 maxAABB{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			uint32_t primitiveCount{};
+		};
+
+		float bestCost{ FLT_MAX };
+		for (int a{ 0 }; a < 3; ++a)
+		{
+			// Bin on the bounds of the centroids, not the primitives, so every bin can receive primitives
+			float boundsMin{ FLT_MAX };
+			float boundsMax{ -FLT_MAX };
+			for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+			{
+				const float c{ centroids[primitiveIndices[node.leftFirst + i]][a] };
+				boundsMin = std::min(boundsMin, c);
+				boundsMax = std::max(boundsMax, c);
+			}
+			if (boundsMin == boundsMax) continue;
+
+			Bin bins[m_NrBins]{};
+			const float scale{ m_NrBins / (boundsMax - boundsMin) };
+			for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+			{
+				const uint32_t primitiveIndex{ primitiveIndices[node.leftFirst + i] };
+				const int binIndex{ std::min(m_NrBins - 1, static_cast<int>((centroids[primitiveIndex][a] - boundsMin) * scale)) };
+				Bin& bin{ bins[binIndex] };
+				++bin.primitiveCount;
+				bin.minAABB = Vector3::Min(bin.minAABB, minBounds[primitiveIndex]);
+				bin.maxAABB = Vector3::Max(bin.maxAABB, maxBounds[primitiveIndex]);
+			}
+
+			// Sweep from both sides to get the area and count on each side of every bin plane
+			float leftArea[m_NrBins - 1]{}, rightArea[m_NrBins - 1]{};
+			uint32_t leftCount[m_NrBins - 1]{}, rightCount[m_NrBins - 1]{};
+			Bin leftBox{}, rightBox{};
+			uint32_t leftSum{}, rightSum{};
+			for (int i{ 0 }; i < m_NrBins - 1; ++i)
+			{
+				leftSum += bins[i].primitiveCount;
+				leftCount[i] = leftSum;
+				leftBox.minAABB = Vector3::Min(leftBox.minAABB, bins[i].minAABB);
+				leftBox.maxAABB = Vector3::Max(leftBox.maxAABB, bins[i].maxAABB);
+				leftArea[i] = leftSum ? SurfaceArea(leftBox.minAABB, leftBox.maxAABB) : 0.f;
+
+				rightSum += bins[m_NrBins - 1 - i].primitiveCount;
+				rightCount[m_NrBins - 2 - i] = rightSum;
+				rightBox.minAABB = Vector3::Min(rightBox.minAABB, bins[m_NrBins - 1 - i].minAABB);
+				rightBox.maxAABB = Vector3::Max(rightBox.maxAABB, bins[m_NrBins - 1 - i].maxAABB);
+				rightArea[m_NrBins - 2 - i] = rightSum ? SurfaceArea(rightBox.minAABB, rightBox.maxAABB) : 0.f;
+			}
+
+			const float binWidth{ (boundsMax - boundsMin) / m_NrBins };
+			for (int i{ 0 }; i < m_NrBins - 1; ++i)
+			{
+				const float cost{ LeafCost(leftCount[i]) * leftArea[i] + LeafCost(rightCount[i]) * rightArea[i] };
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					axis = a;
+					splitPosition = boundsMin + binWidth * (i + 1);
+				}
+			}
+		}
+		return bestCost;
+	}
+
+	void BVH::Subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds, const std::vector<Vector3>& centroids)
+	{
+		// Skewed splits (clustered primitives) can go deeper than the traversal stacks allow, whatever is left there becomes one leaf
+		if (nodes[nodeIndex].primitiveCount <= 1 || depth >= g_MaxBVHDepth) return;
+
+		int axis{ -1 };
+		float splitPosition{};
+		const float splitCost{ FindBestSplit(nodes[nodeIndex], minBounds, maxBounds, centroids, axis, splitPosition) };
+		if (axis == -1) return; // All centroids coincide, nothing left to split on
+
+		// Only split when it is cheaper than intersecting every primitive of this node, or when the leaf would be too big
+		const uint32_t first{ nodes[nodeIndex].leftFirst };
+		const uint32_t count{ nodes[nodeIndex].primitiveCount };
+		const float leafCost{ LeafCost(count) * SurfaceArea(nodes[nodeIndex].minAABB, nodes[nodeIndex].maxAABB) };
+		if (splitCost >= leafCost && count <= std::max(m_MaxLeafSize, leafBlockSize)) return;
+
+		// Partition the primitives in place around the split plane
+		int i{ static_cast<int>(first) };
+		int j{ i + static_cast<int>(count) - 1 };
+		while (i <= j)
+		{
+			if (centroids[primitiveIndices[i]][axis] < splitPosition)
+			{
+				++i;
+			}
+			else
+			{
+				std::swap(primitiveIndices[i], primitiveIndices[j--]);
+			}
+		}
+
+		const uint32_t leftCount{ static_cast<uint32_t>(i) - first };
+		if (leftCount == 0 || leftCount == count) return;
+
+		const uint32_t leftChildIndex{ static_cast<uint32_t>(nodes.size()) };
+		BVHNode leftChild{};
+		leftChild.leftFirst = first;
+		leftChild.primitiveCount = leftCount;
+		BVHNode rightChild{};
+		rightChild.leftFirst = static_cast<uint32_t>(i);
+		rightChild.primitiveCount = count - leftCount;
+
+		nodes[nodeIndex].leftFirst = leftChildIndex;
+		nodes[nodeIndex].primitiveCount = 0;
+		nodes.push_back(leftChild);
+		nodes.push_back(rightChild);
+
+		UpdateNodeBounds(leftChildIndex, minBounds, maxBounds);
+		UpdateNodeBounds(leftChildIndex + 1, minBounds, maxBounds);
+
+		Subdivide(leftChildIndex, depth + 1, minBounds, maxBounds, centroids);
+		Subdivide(leftChildIndex + 1, depth + 1, minBounds, maxBounds, centroids);
+	}
+}
\ No newline at end of file
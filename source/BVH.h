@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	// Fixed traversal stacks, binary trees (rays and packets) and 4-wide trees
+	constexpr uint32_t g_BVHStackSize{ 64 };
+	constexpr uint32_t g_WideBVHStackSize{ 128 };
+	// A binary traversal holds at most one entry per level + 1, a 4-wide one at most 3 per level + 1 (never deeper than its binary tree)
+	// The build turns every node at this depth into a leaf, so no valid input can overflow the stacks
+	constexpr uint32_t g_MaxBVHDepth{ std::min(g_BVHStackSize - 1, (g_WideBVHStackSize - 1) / 3) };
+
+	struct BVHNode
+	{
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
+
+		// Interior node >> index of the left child (right child is leftFirst + 1)
+		// Leaf node >> index of the first primitive in BVH::primitiveIndices
+		uint32_t leftFirst{};
+		uint32_t primitiveCount{};
+
+		bool IsLeaf() const { return primitiveCount > 0; }
+	};
+
+	/**
+	 * \brief Bounding Volume Hierarchy over an arbitrary set of bounded primitives (triangles, objects, ...)
+	 * Built top-down with a binned Surface Area Heuristic
+	 */
+	struct BVH
+	{
+		std::vector<BVHNode> nodes{};
+		std::vector<uint32_t> primitiveIndices{};
+
+		// SAH cost right after the last full build, refits are measured against it
+		float buildCost{};
+		// Primitives a leaf intersects at once (SIMD blocks), the SAH charges a leaf per block instead of per primitive
+		uint32_t leafBlockSize{ 1 };
+
+		/**
+		 * \brief Builds the hierarchy from scratch
+		 * \param minBounds Min corner of the AABB of every primitive
+		 * \param maxBounds Max corner of the AABB of every primitive
+		 * \param centroids Centroid of every primitive, used to bin the primitives
+		 * \param blockSize Primitives a leaf intersects at once
+		 */
+		void Build(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds, const std::vector<Vector3>& centroids, uint32_t blockSize = 1);
+
+		/**
+		 * \brief Builds the hierarchy over a triangle list (3 indices per triangle)
+		 * \param positions Vertex positions
+		 * \param indices Triangle indices
+		 * \param blockSize Triangles a leaf intersects at once
+		 */
+		void BuildFromTriangles(const std::vector<Vector3>& positions, const std::vector<int>& indices, uint32_t blockSize = 1);
+
+		/**
+		 * \brief Recomputes every node's bounds bottom-up, keeping the topology as is (O(n))
+		 * \param minBounds Min corner of the AABB of every primitive (same primitive order as the build)
+		 * \param maxBounds Max corner of the AABB of every primitive (same primitive order as the build)
+		 */
+		void Refit(const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds);
+
+		/**
+		 * \brief Refits over a triangle list, reading the leaf bounds straight from the vertices
+		 * \param positions Vertex positions (may have moved since the build, the triangles may not have changed)
+		 * \param indices Triangle indices
+		 */
+		void RefitFromTriangles(const std::vector<Vector3>& positions, const std::vector<int>& indices);
+
+		/**
+		 * \brief Surface Area Heuristic cost of the whole tree, relative to the root area
+		 * \return Expected cost of tracing a random ray through the tree
+		 */
+		float CalculateSAHCost() const;
+
+		/**
+		 * \brief Compares the current SAH cost against the cost right after the last build
+		 * \param threshold Allowed cost ratio before the refitted tree is considered degraded
+		 * \return True when a full rebuild pays off
+		 */
+		bool NeedsRebuild(float threshold) const;
+
+		void Clear();
+		bool IsEmpty() const { return nodes.empty(); }
+
+	private:
+		static constexpr int m_NrBins{ 12 };
+		static constexpr uint32_t m_MaxLeafSize{ 4 };
+		static constexpr float m_TraversalCost{ 1.f };
+		static constexpr float m_IntersectionCost{ 1.f };
+
+		void Subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds, const std::vector<Vector3>& centroids);
+		void UpdateNodeBounds(uint32_t nodeIndex, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds);
+		float LeafCost(uint32_t primitiveCount) const;
+		float FindBestSplit(const BVHNode& node, const std::vector<Vector3>& minBounds, const std::vector<Vector3>& maxBounds, const std::vector<Vector3>& centroids, int& axis, float& splitPosition) const;
+	};
+
+	inline float SurfaceArea(const Vector3& minAABB, const Vector3& maxAABB)
+	{
+		const Vector3 extent{ maxAABB - minAABB };
+		return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+#include "Math.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "Trace.h"
+
+namespace dae
+{
+	namespace
+	{
+		// Sways the view left and right around where the scene placed the camera while moving in and out
+		void ApplyCameraPath(Camera& camera, const Vector3& startOrigin, const Vector3& startForward, float time)
+		{
+			constexpr float maxYaw{ 15.f * TO_RADIANS };
+			constexpr float maxDolly{ 1.f };
+
+			camera.forward = Matrix::CreateRotationY(sinf(time * 0.5f) * maxYaw).TransformVector(startForward).Normalized();
+			camera.origin = startOrigin + startForward * (sinf(time) * maxDolly);
+			++camera.version;
+		}
+
+		// Nearest rank on an already sorted list
+		float GetPercentile(const std::vector<float>& sortedValues, float percentile)
+		{
+			const size_t rank{ static_cast<size_t>(std::ceil(percentile / 100.f * sortedValues.size())) };
+			return sortedValues[std::clamp<size_t>(rank, 1, sortedValues.size()) - 1];
+		}
+	}
+
+	Benchmark::Benchmark(const Settings& settings) :
+		m_Settings{ settings },
+		m_FrameBuffer{ settings.width, settings.height },
+		m_Renderer{ &m_FrameBuffer }
+	{
+		// Every frame has to trace the full image, also when the camera path happens to stand still
+		m_Renderer.SetAccumulationEnabled(false);
+	}
+
+	void Benchmark::RunScene(const std::string& sceneName, Scene* pScene)
+	{
+		SceneResult result{};
+		result.sceneName = sceneName;
+		result.frameTimes.reserve(m_Settings.nrFrames);
+
+		Camera& camera{ pScene->GetCamera() };
+		const Vector3 startOrigin{ camera.origin };
+		const Vector3 startForward{ camera.forward };
+
+		Timer timer{};
+		timer.SetFixedTimeStep(m_Settings.timeStep);
+		timer.Start();
+
+		const int nrFrames{ m_Settings.nrWarmupFrames + m_Settings.nrFrames };
+		for (int frame{ 0 }; frame < nrFrames; ++frame)
+		{
+			TRACE_ZONE_ARG("Frame", frame);
+			const auto frameStart{ std::chrono::steady_clock::now() };
+
+			timer.Update();
+			{
+				TRACE_ZONE("Scene::Update");
+				pScene->Update(&timer);
+				// Overrides whatever the camera did with the input
+				ApplyCameraPath(camera, startOrigin, startForward, timer.GetTotal());
+			}
+			{
+				TRACE_ZONE("Renderer::Render");
+				m_Renderer.Render(pScene);
+			}
+
+			const auto frameEnd{ std::chrono::steady_clock::now() };
+
+			if (frame < m_Settings.nrWarmupFrames) continue;
+			result.frameTimes.push_back(std::chrono::duration<float, std::milli>(frameEnd - frameStart).count());
+			result.nrRays += m_Renderer.GetNrRaysLastFrame();
+			result.statistics += m_Renderer.GetStatisticsLastFrame();
+		}
+		timer.Stop();
+
+		CalculateStatistics(result);
+		m_Results.push_back(std::move(result));
+	}
+
+	void Benchmark::PrintSummary() const
+	{
+		std::cout << std::fixed << std::setprecision(2);
+		for (const SceneResult& result : m_Results)
+		{
+			std::cout << result.sceneName
+				<< ": MIN = " << result.minFrameTime
+				<< " ms, MEDIAN = " << result.medianFrameTime
+				<< " ms, P95 = " << result.p95FrameTime
+				<< " ms, P99 = " << result.p99FrameTime
+				<< " ms, MAX = " << result.maxFrameTime
+				<< " ms, " << result.megaRaysPerSecond << " Mrays/s\n";
+#ifdef RAY_STATISTICS
+			std::cout << "  " << Statistics::FormatReport(result.statistics, result.averageFrameTime * result.frameTimes.size() / 1000.f) << '\n';
+#endif
+		}
+		std::cout << std::defaultfloat;
+	}
+
+	bool Benchmark::SaveJSON(const std::string& filePath) const
+	{
+		std::ofstream file{ filePath };
+		if (!file) return false;
+
+		file << std::fixed << std::setprecision(4);
+		file << "{\n";
+		file << "  \"width\": " << m_Settings.width << ",\n";
+		file << "  \"height\": " << m_Settings.height << ",\n";
+		file << "  \"frames\": " << m_Settings.nrFrames << ",\n";
+		file << "  \"warmupFrames\": " << m_Settings.nrWarmupFrames << ",\n";
+		file << "  \"timeStep\": " << m_Settings.timeStep << ",\n";
+		file << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+		file << "  \"scenes\": [\n";
+		for (size_t i{ 0 }; i < m_Results.size(); ++i)
+		{
+			const SceneResult& result{ m_Results[i] };
+			file << "    {\n";
+			file << "      \"name\": \"" << result.sceneName << "\",\n";
+			file << "      \"minMs\": " << result.minFrameTime << ",\n";
+			file << "      \"medianMs\": " << result.medianFrameTime << ",\n";
+			file << "      \"p95Ms\": " << result.p95FrameTime << ",\n";
+			file << "      \"p99Ms\": " << result.p99FrameTime << ",\n";
+			file << "      \"maxMs\": " << result.maxFrameTime << ",\n";
+			file << "      \"averageMs\": " << result.averageFrameTime << ",\n";
+			file << "      \"rays\": " << result.nrRays << ",\n";
+			file << "      \"mraysPerSecond\": " << result.megaRaysPerSecond << ",\n";
+#ifdef RAY_STATISTICS
+			const Statistics::Counters& statistics{ result.statistics };
+			const double raysPerRay{ statistics.GetNrRays() > 0 ? 1.0 / statistics.GetNrRays() : 0.0 };
+			file << "      \"primaryRays\": " << statistics[Statistics::Counter::PrimaryRays] << ",\n";
+			file << "      \"secondaryRays\": " << statistics.GetNrSecondaryRays() << ",\n";
+			file << "      \"shadowRays\": " << statistics[Statistics::Counter::ShadowRays] << ",\n";
+			file << "      \"nodeVisits\": " << statistics[Statistics::Counter::NodeVisits] << ",\n";
+			file << "      \"primitiveTests\": " << statistics[Statistics::Counter::PrimitiveTests] << ",\n";
+			file << "      \"hits\": " << statistics[Statistics::Counter::Hits] << ",\n";
+			file << "      \"nodeVisitsPerRay\": " << statistics[Statistics::Counter::NodeVisits] * raysPerRay << ",\n";
+			file << "      \"primitiveTestsPerRay\": " << statistics[Statistics::Counter::PrimitiveTests] * raysPerRay << ",\n";
+#endif
+			file << "      \"frameTimesMs\": [";
+			for (size_t frame{ 0 }; frame < result.frameTimes.size(); ++frame)
+			{
+				file << (frame == 0 ? "" : ", ") << result.frameTimes[frame];
+			}
+			file << "]\n";
+			file << "    }" << (i + 1 < m_Results.size() ? "," : "") << '\n';
+		}
+		file << "  ]\n";
+		file << "}\n";
+		return file.good();
+	}
+
+	bool Benchmark::SaveCSV(const std::string& filePath) const
+	{
+		std::ofstream file{ filePath };
+		if (!file) return false;
+
+		file << std::fixed << std::setprecision(4);
+		file << "scene,frames,min_ms,median_ms,p95_ms,p99_ms,max_ms,average_ms,rays,mrays_per_s";
+#ifdef RAY_STATISTICS
+		file << ",node_visits_per_ray,primitive_tests_per_ray";
+#endif
+		file << '\n';
+		for (const SceneResult& result : m_Results)
+		{
+			file << result.sceneName << ','
+				<< result.frameTimes.size() << ','
+				<< result.minFrameTime << ','
+				<< result.medianFrameTime << ','
+				<< result.p95FrameTime << ','
+				<< result.p99FrameTime << ','
+				<< result.maxFrameTime << ','
+				<< result.averageFrameTime << ','
+				<< result.nrRays << ','
+				<< result.megaRaysPerSecond;
+#ifdef RAY_STATISTICS
+			const double raysPerRay{ result.statistics.GetNrRays() > 0 ? 1.0 / result.statistics.GetNrRays() : 0.0 };
+			file << ',' << result.statistics[Statistics::Counter::NodeVisits] * raysPerRay
+				<< ',' << result.statistics[Statistics::Counter::PrimitiveTests] * raysPerRay;
+#endif
+			file << '\n';
+		}
+		return file.good();
+	}
+
+	void Benchmark::CalculateStatistics(SceneResult& result)
+	{
+		if (result.frameTimes.empty()) return;
+
+		std::vector<float> sortedFrameTimes{ result.frameTimes };
+		std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+
+		result.minFrameTime = sortedFrameTimes.front();
+		result.medianFrameTime = GetPercentile(sortedFrameTimes, 50.f);
+		result.p95FrameTime = GetPercentile(sortedFrameTimes, 95.f);
+		result.p99FrameTime = GetPercentile(sortedFrameTimes, 99.f);
+		result.maxFrameTime = sortedFrameTimes.back();
+
+		const double totalTime{ std::accumulate(sortedFrameTimes.begin(), sortedFrameTimes.end(), 0.0) };
+		result.averageFrameTime = static_cast<float>(totalTime / sortedFrameTimes.size());
+		// Milliseconds to seconds and rays to millions of rays cancel out to a factor 1000
+		result.megaRaysPerSecond = totalTime > 0.0 ? result.nrRays / totalTime / 1000.0 : 0.0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameBuffer.h"
+#include "Renderer.h"
+
+namespace dae
+{
+	class Scene;
+
+	/**
+	 * \brief Renders scenes without a window for a fixed number of frames and records every frame time
+	 * Scenes are simulated with a fixed time step and the camera follows a scripted path,
+	 * so every run renders exactly the same frames and results can be compared across builds
+	 */
+	class Benchmark final
+	{
+	public:
+		struct Settings
+		{
+			int width{ 640 };
+			int height{ 480 };
+			int nrFrames{ 60 };
+			// Rendered before recording starts (first BVH builds, cold caches)
+			int nrWarmupFrames{ 2 };
+			float timeStep{ 1.f / 30.f };
+		};
+
+		explicit Benchmark(const Settings& settings);
+		~Benchmark() = default;
+
+		Benchmark(const Benchmark&) = delete;
+		Benchmark(Benchmark&&) noexcept = delete;
+		Benchmark& operator=(const Benchmark&) = delete;
+		Benchmark& operator=(Benchmark&&) noexcept = delete;
+
+		// The scene has to be initialized, it is updated and rendered from its initial state
+		void RunScene(const std::string& sceneName, Scene* pScene);
+
+		void PrintSummary() const;
+		// Both return false when the file could not be written
+		bool SaveJSON(const std::string& filePath) const;
+		bool SaveCSV(const std::string& filePath) const;
+
+	private:
+		struct SceneResult
+		{
+			std::string sceneName{};
+			// Update + render time of every recorded frame, in milliseconds
+			std::vector<float> frameTimes{};
+			uint64_t nrRays{};
+			// Summed over the recorded frames, only filled in with RAY_STATISTICS
+			Statistics::Counters statistics{};
+
+			float minFrameTime{};
+			float medianFrameTime{};
+			float p95FrameTime{};
+			float p99FrameTime{};
+			float maxFrameTime{};
+			float averageFrameTime{};
+			double megaRaysPerSecond{};
+		};
+
+		Settings m_Settings;
+		MemoryFrameBuffer m_FrameBuffer;
+		Renderer m_Renderer;
+
+		std::vector<SceneResult> m_Results{};
+
+		static void CalculateStatistics(SceneResult& result);
+	};
+}
\ No newline at end of file
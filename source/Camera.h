@@ -1,7 +1,9 @@
 #pragma once
 #include <cassert>
+#if !defined(HEADLESS_ONLY)
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
+#endif
 
 #include "Math.h"
 #include "Timer.h"
@@ -32,6 +34,9 @@ namespace dae
 
 		Matrix cameraToWorld{};
 
+		// Bumped whenever the view changes, the renderer only accumulates samples while it stays the same
+		uint32_t version{};
+
 
 		Matrix CalculateCameraToWorld()
 		{
@@ -61,16 +66,20 @@ namespace dae
 		{
 			fovAngle = newFovAngle;
 			fovMultiplier = tanf(TO_RADIANS * newFovAngle / 2.0f);
+			++version;
 		}
 
 		void Update(Timer* pTimer)
 		{
+			// Without a window there is no input to move the camera with
+#if !defined(HEADLESS_ONLY)
 			const float fovChangingSpeed{ 25 };
 			const float baseMovementSpeed{ 0.5f };
 			float movementSpeed{ baseMovementSpeed };
 			const float rotationSpeed{ 1/32.f };
 
 			const float deltaTime = pTimer->GetElapsed();
+			bool hasMoved{ false };
 
 			//Keyboard Input
 			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
@@ -103,18 +112,22 @@ namespace dae
 			if (pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP])
 			{
 				origin += forward * movementSpeed;
+				hasMoved = true;
 			}
 			else if (pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN])
 			{
 				origin -= forward * movementSpeed;
+				hasMoved = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT])
 			{
 				origin += right * movementSpeed;
+				hasMoved = true;
 			}
 			else if (pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT])
 			{
 				origin -= right * movementSpeed;
+				hasMoved = true;
 			}
 #pragma endregion 
 
@@ -126,6 +139,7 @@ namespace dae
 			// LMB
 			if (mouseState & SDL_BUTTON(SDL_BUTTON_LEFT))
 			{
+				hasMoved |= mouseY != 0;
 				// RMB
 				if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT))
 				{
@@ -141,10 +155,14 @@ namespace dae
 #pragma region Rotation
 			if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT))
 			{
+				hasMoved |= mouseX != 0 || mouseY != 0;
 				forward = Matrix::CreateRotationY(mouseX * rotationSpeed).TransformVector(forward);
 				forward = Matrix::CreateRotationX(-mouseY * rotationSpeed).TransformVector(forward) ;
 			}
 #pragma endregion
+
+			if (hasMoved) ++version;
+#endif
 		}
 	};
 }
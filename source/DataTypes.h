@@ -1,7 +1,11 @@
 #pragma once
 #include <cassert>
+#include <cfloat>
 
 #include "Math.h"
+#include "BVH.h"
+#include "WideBVH.h"
+#include "TriangleBlocks.h"
 #include "vector"
 
 namespace dae
@@ -30,6 +34,31 @@ namespace dae
 		NoCulling
 	};
 
+	// Transforms all 8 corners of an AABB and returns the AABB around them
+	inline void TransformAABB(const Matrix& transform, const Vector3& minAABB, const Vector3& maxAABB, Vector3& transformedMinAABB, Vector3& transformedMaxAABB)
+	{
+		Vector3 tMinAABB = transform.TransformPoint(minAABB);
+		Vector3 tMaxAABB = tMinAABB;
+		for (int corner{ 1 }; corner < 8; ++corner)
+		{
+			const Vector3 tAABB = transform.TransformPoint(
+				(corner & 1) ? maxAABB.x : minAABB.x,
+				(corner & 2) ? maxAABB.y : minAABB.y,
+				(corner & 4) ? maxAABB.z : minAABB.z);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+		}
+
+		transformedMinAABB = tMinAABB;
+		transformedMaxAABB = tMaxAABB;
+	}
+
+	enum class MeshTransformMode
+	{
+		ObjectSpace, // Rays are moved into object space, vertices and BVH are never touched by transform updates
+		WorldSpace   // Vertices are transformed into world space on every transform update and the BVH refitted
+	};
+
 	struct Triangle
 	{
 		Triangle() = default;
@@ -90,9 +119,30 @@ namespace dae
 		Vector3 transformedMinAABB;
 		Vector3 transformedMaxAABB;
 
+		MeshTransformMode transformMode{ MeshTransformMode::ObjectSpace };
+
+		// ObjectSpace mode: moves rays into object space and the object space normals back out
+		Matrix worldToObject{};
+		Matrix normalToWorld{};
+
+		// WorldSpace mode only
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
 
+		// Hierarchy over the triangles in the space of the active mode, refitted on updates
+		BVH bvh{};
+		// SAH cost ratio (refitted / freshly built) above which the BVH gets rebuilt
+		float bvhRebuildThreshold{ 1.25f };
+		// 4-wide copy of the BVH that is actually traversed, leaves still index the binary BVH
+		WideBVH wideBVH{};
+		// The leaf triangles of the BVH in SIMD layout, repacked whenever the BVH changes
+		TriangleBlockList triangleBlocks{};
+		// Same for the scalar traversal, only filled when the SIMD blocks are disabled
+		TriangleRecordList triangleRecords{};
+
+		// Bumped whenever the transform or the geometry is updated, Scene::GetVersion sums it up
+		uint32_t version{};
+
 		void Translate(const Vector3& translation)
 		{
 			translationTransform = Matrix::CreateTranslation(translation);
@@ -146,28 +196,30 @@ namespace dae
 		void UpdateTransforms()
 		{
 			//Calculate Final Transform 
-			//const auto finalTransform = ...
 			const auto TRS = scaleTransform * rotationTransform * translationTransform;
-			const auto unscaledTRS = rotationTransform * translationTransform;
+			++version;
 
-			transformedPositions.clear();
-			transformedPositions.reserve(positions.size());
-			transformedNormals.clear();
-			transformedNormals.reserve(normals.size());
-			// Transform Positions (positions > transformedPositions)
-			for (Vector3& position : positions)
+			switch (transformMode)
 			{
-				transformedPositions.emplace_back(TRS.TransformPoint(position));
+			case MeshTransformMode::ObjectSpace:
+				UpdateObjectSpaceTransforms(TRS);
+				break;
+			case MeshTransformMode::WorldSpace:
+				UpdateWorldSpaceTransforms(TRS);
+				break;
 			}
+		}
 
-			// Transform Normals (normals > transformedNormals)
-			for (Vector3& normal : normals)
+		// ObjectSpace mode: call after editing positions (deforming), topology changes are picked up by UpdateTransforms
+		void UpdateGeometry()
+		{
+			++version;
+			UpdateBVH(positions, normals);
+			if (!bvh.IsEmpty())
 			{
-				transformedNormals.emplace_back(unscaledTRS.TransformVector(normal));
+				minAABB = bvh.nodes[0].minAABB;
+				maxAABB = bvh.nodes[0].maxAABB;
 			}
-
-			// UpdateAABB
-			UpdateTransformedAABB(TRS);
 		}
 
 		void UpdateAABB()
@@ -188,48 +240,127 @@ namespace dae
 		void UpdateTransformedAABB(const Matrix& finalTransform)
 		{
 			// Update Transformed AABB
-			// and calculate new min and max
-			Vector3 tMinAABB = finalTransform.TransformPoint(minAABB);
-			Vector3 tMaxAABB = tMinAABB;
-			// (xmax, ymin, zmin)
-			Vector3 tAABB = finalTransform.TransformPoint(maxAABB.x, minAABB.y, minAABB.z);
+			TransformAABB(finalTransform, minAABB, maxAABB, transformedMinAABB, transformedMaxAABB);
+		}
+
+	private:
+		void UpdateObjectSpaceTransforms(const Matrix& TRS)
+		{
+			worldToObject = Matrix::Inverse(TRS);
+			// Inverse transpose keeps normals perpendicular under non-uniform scale
+			normalToWorld = Matrix::Transpose(worldToObject);
+
+			// Geometry seen for the first time (or triangles added)
+			if (bvh.primitiveIndices.size() != indices.size() / 3)
 			{
-				tMinAABB = Vector3::Min(tAABB, tMinAABB);
-				tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+				UpdateGeometry();
 			}
-			// (xmax, ymin, zmax)
-			tAABB = finalTransform.TransformPoint(maxAABB.x, minAABB.y, maxAABB.z);
+
+			if (!transformedPositions.empty())
 			{
-				tMinAABB = Vector3::Min(tAABB, tMinAABB);
-				tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+				transformedPositions.clear();
+				transformedPositions.shrink_to_fit();
+				transformedNormals.clear();
+				transformedNormals.shrink_to_fit();
 			}
-			// (xmin, ymin, zmax)
-			tAABB = finalTransform.TransformPoint(minAABB.x, minAABB.y, maxAABB.z);
+
+			UpdateTransformedAABB(TRS);
+		}
+
+		void UpdateWorldSpaceTransforms(const Matrix& TRS)
+		{
+			const auto unscaledTRS = rotationTransform * translationTransform;
+
+			transformedPositions.clear();
+			transformedPositions.reserve(positions.size());
+			transformedNormals.clear();
+			transformedNormals.reserve(normals.size());
+			// Transform Positions (positions > transformedPositions)
+			for (Vector3& position : positions)
 			{
-				tMinAABB = Vector3::Min(tAABB, tMinAABB);
-				tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+				transformedPositions.emplace_back(TRS.TransformPoint(position));
 			}
-			// (xmax, ymax, zmin)
-			tAABB = finalTransform.TransformPoint(maxAABB.x, maxAABB.y, minAABB.z);
+
+			// Transform Normals (normals > transformedNormals)
+			for (Vector3& normal : normals)
 			{
-				tMinAABB = Vector3::Min(tAABB, tMinAABB);
-				tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+				transformedNormals.emplace_back(unscaledTRS.TransformVector(normal));
 			}
-			// (xmax, ymax, zmax)
-			tAABB = finalTransform.TransformPoint(maxAABB);
+
+			// The root bounds are the exact transformed AABB
+			UpdateBVH(transformedPositions, transformedNormals);
+			if (!bvh.IsEmpty())
+			{
+				transformedMinAABB = bvh.nodes[0].minAABB;
+				transformedMaxAABB = bvh.nodes[0].maxAABB;
+			}
+			else
+			{
+				UpdateTransformedAABB(TRS);
+			}
+		}
+
+		void UpdateBVH(const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals)
+		{
+			// Same triangles only moved: refit the BVH in O(n), rebuild only once its quality drifted too far
+			const bool trianglesChanged{ bvh.primitiveIndices.size() != indices.size() / 3 };
+			if (trianglesChanged)
 			{
-				tMinAABB = Vector3::Min(tAABB, tMinAABB);
-				tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+				bvh.BuildFromTriangles(vertices, indices, g_TriangleBlockSize);
+				wideBVH.Build(bvh);
 			}
-			// (xmin, ymax, zmax)
-			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, minAABB.z);
+			else
 			{
-				tMinAABB = Vector3::Min(tAABB, tMinAABB);
-				tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+				bvh.RefitFromTriangles(vertices, indices);
+				if (bvh.NeedsRebuild(bvhRebuildThreshold))
+				{
+					bvh.BuildFromTriangles(vertices, indices, g_TriangleBlockSize);
+					wideBVH.Build(bvh);
+				}
+				else
+				{
+					wideBVH.Refit(bvh);
+				}
 			}
 
-			transformedMinAABB = tMinAABB;
-			transformedMaxAABB = tMaxAABB;
+			// The blocks and records hold copies of the vertices, so they follow every refit too
+#ifdef USE_TRIANGLE_BLOCKS
+			triangleBlocks.Build(bvh, vertices, indices, faceNormals);
+#else
+			triangleRecords.Build(bvh, vertices, indices, faceNormals);
+#endif
+		}
+	};
+
+	using MeshHandle = uint32_t;
+
+	// Placement of a shared, immutable TriangleMesh (intersected in object space, like MeshTransformMode::ObjectSpace)
+	struct MeshInstance
+	{
+		MeshHandle mesh{};
+		unsigned char materialIndex{};
+
+		Matrix objectToWorld{};
+		Matrix worldToObject{};
+		Matrix normalToWorld{};
+
+		Vector3 transformedMinAABB{};
+		Vector3 transformedMaxAABB{};
+
+		// Bumped by SetTransform, Scene::GetVersion sums it up
+		uint32_t version{};
+
+		void SetTransform(const Matrix& transform)
+		{
+			++version;
+			objectToWorld = transform;
+			worldToObject = Matrix::Inverse(transform);
+			normalToWorld = Matrix::Transpose(worldToObject);
+		}
+
+		void UpdateTransformedAABB(const TriangleMesh& triangleMesh)
+		{
+			TransformAABB(objectToWorld, triangleMesh.minAABB, triangleMesh.maxAABB, transformedMinAABB, transformedMaxAABB);
 		}
 	};
 #pragma endregion
@@ -253,8 +384,14 @@ namespace dae
 #pragma region MISC
 	struct Ray
 	{
+		Ray() = default;
+		Ray(const Vector3& _origin, const Vector3& _direction, float _min = 0.0001f, float _max = FLT_MAX) :
+			origin{ _origin }, direction{ _direction }, inversedDirection{ 1.f / _direction.x, 1.f / _direction.y, 1.f / _direction.z }, min{ _min }, max{ _max } {}
+
 		Vector3 origin{};
 		Vector3 direction{};
+		// Reciprocal of the direction for the slab tests, computed once per ray (construct a new Ray when the direction changes)
+		Vector3 inversedDirection{};
 
 		float min{ 0.0001f };
 		float max{ FLT_MAX };
@@ -0,0 +1,78 @@
+#pragma once
+#include <cmath>
+
+#include "SIMD.h"
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace dae
+{
+	/**
+	 * \brief Four floats in one SSE/NEON register (plain floats on other targets)
+	 * Only for the arithmetic itself: load from and store to the regular math types around it
+	 * Every operation works lane by lane, so results are identical to the same expression written per component
+	 */
+	struct Float4
+	{
+#if defined(SIMD_X86)
+		__m128 value;
+
+		static Float4 Load(const float* pValues) { return { _mm_loadu_ps(pValues) }; }
+		static Float4 Splat(float value) { return { _mm_set1_ps(value) }; }
+		void Store(float* pValues) const { _mm_storeu_ps(pValues, value); }
+
+		Float4 operator+(const Float4& other) const { return { _mm_add_ps(value, other.value) }; }
+		Float4 operator-(const Float4& other) const { return { _mm_sub_ps(value, other.value) }; }
+		Float4 operator*(const Float4& other) const { return { _mm_mul_ps(value, other.value) }; }
+		Float4 operator/(const Float4& other) const { return { _mm_div_ps(value, other.value) }; }
+
+		static Float4 Min(const Float4& a, const Float4& b) { return { _mm_min_ps(a.value, b.value) }; }
+		static Float4 Max(const Float4& a, const Float4& b) { return { _mm_max_ps(a.value, b.value) }; }
+		static Float4 Sqrt(const Float4& a) { return { _mm_sqrt_ps(a.value) }; }
+#elif defined(SIMD_NEON)
+		float32x4_t value;
+
+		static Float4 Load(const float* pValues) { return { vld1q_f32(pValues) }; }
+		static Float4 Splat(float value) { return { vdupq_n_f32(value) }; }
+		void Store(float* pValues) const { vst1q_f32(pValues, value); }
+
+		Float4 operator+(const Float4& other) const { return { vaddq_f32(value, other.value) }; }
+		Float4 operator-(const Float4& other) const { return { vsubq_f32(value, other.value) }; }
+		Float4 operator*(const Float4& other) const { return { vmulq_f32(value, other.value) }; }
+		Float4 operator/(const Float4& other) const { return { vdivq_f32(value, other.value) }; }
+
+		static Float4 Min(const Float4& a, const Float4& b) { return { vminq_f32(a.value, b.value) }; }
+		static Float4 Max(const Float4& a, const Float4& b) { return { vmaxq_f32(a.value, b.value) }; }
+		static Float4 Sqrt(const Float4& a) { return { vsqrtq_f32(a.value) }; }
+#else
+		float value[4];
+
+		static Float4 Load(const float* pValues) { return { { pValues[0], pValues[1], pValues[2], pValues[3] } }; }
+		static Float4 Splat(float value) { return { { value, value, value, value } }; }
+		void Store(float* pValues) const
+		{
+			for (int i{ 0 }; i < 4; ++i) pValues[i] = value[i];
+		}
+
+		Float4 operator+(const Float4& other) const { return Apply(other, [](float a, float b) { return a + b; }); }
+		Float4 operator-(const Float4& other) const { return Apply(other, [](float a, float b) { return a - b; }); }
+		Float4 operator*(const Float4& other) const { return Apply(other, [](float a, float b) { return a * b; }); }
+		Float4 operator/(const Float4& other) const { return Apply(other, [](float a, float b) { return a / b; }); }
+
+		static Float4 Min(const Float4& a, const Float4& b) { return a.Apply(b, [](float x, float y) { return y < x ? y : x; }); }
+		static Float4 Max(const Float4& a, const Float4& b) { return a.Apply(b, [](float x, float y) { return y > x ? y : x; }); }
+		static Float4 Sqrt(const Float4& a) { return a.Apply(a, [](float x, float) { return sqrtf(x); }); }
+
+	private:
+		template<typename Operation>
+		Float4 Apply(const Float4& other, Operation operation) const
+		{
+			return { { operation(value[0], other.value[0]), operation(value[1], other.value[1]),
+				operation(value[2], other.value[2]), operation(value[3], other.value[3]) } };
+		}
+#endif
+	};
+}
\ No newline at end of file
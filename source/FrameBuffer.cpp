@@ -0,0 +1,66 @@
+#include "FrameBuffer.h"
+
+#include <fstream>
+
+namespace dae
+{
+	bool FrameBuffer::SaveToBMP(const std::string& filePath) const
+	{
+		std::ofstream file{ filePath, std::ios::binary };
+		if (!file) return false;
+
+		// Rows are padded to 4 bytes
+		const uint32_t rowSize{ (static_cast<uint32_t>(m_Width) * 3 + 3) & ~3u };
+		const uint32_t imageSize{ rowSize * static_cast<uint32_t>(m_Height) };
+		constexpr uint32_t headerSize{ 14 + 40 };
+
+		uint8_t header[headerSize]{};
+		const auto writeU16 = [&header](int offset, uint32_t value)
+			{
+				header[offset] = static_cast<uint8_t>(value);
+				header[offset + 1] = static_cast<uint8_t>(value >> 8);
+			};
+		const auto writeU32 = [&header](int offset, uint32_t value)
+			{
+				for (int i{ 0 }; i < 4; ++i) header[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+			};
+
+		// File header
+		header[0] = 'B';
+		header[1] = 'M';
+		writeU32(2, headerSize + imageSize);
+		writeU32(10, headerSize);
+		// Info header
+		writeU32(14, 40);
+		writeU32(18, static_cast<uint32_t>(m_Width));
+		writeU32(22, static_cast<uint32_t>(m_Height));
+		writeU16(26, 1);
+		writeU16(28, 24);
+		writeU32(34, imageSize);
+		writeU32(38, 2835);
+		writeU32(42, 2835);
+		file.write(reinterpret_cast<const char*>(header), headerSize);
+
+		// Bottom row first, stored as BGR
+		std::vector<uint8_t> row(rowSize);
+		for (int y{ m_Height - 1 }; y >= 0; --y)
+		{
+			const uint32_t* pRowPixels{ m_pPixels + y * m_Width };
+			for (int x{ 0 }; x < m_Width; ++x)
+			{
+				row[x * 3] = static_cast<uint8_t>(pRowPixels[x]);
+				row[x * 3 + 1] = static_cast<uint8_t>(pRowPixels[x] >> 8);
+				row[x * 3 + 2] = static_cast<uint8_t>(pRowPixels[x] >> 16);
+			}
+			file.write(reinterpret_cast<const char*>(row.data()), rowSize);
+		}
+		return file.good();
+	}
+
+	MemoryFrameBuffer::MemoryFrameBuffer(int width, int height) :
+		FrameBuffer(width, height),
+		m_Pixels(static_cast<size_t>(width) * height)
+	{
+		m_pPixels = m_Pixels.data();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Surface the renderer writes its pixels into
+	 * Pixels are 32 bit 0x00RRGGBB, row after row without padding
+	 */
+	class FrameBuffer
+	{
+	public:
+		FrameBuffer(int width, int height) : m_Width{ width }, m_Height{ height } {}
+		virtual ~FrameBuffer() = default;
+
+		FrameBuffer(const FrameBuffer&) = delete;
+		FrameBuffer(FrameBuffer&&) noexcept = delete;
+		FrameBuffer& operator=(const FrameBuffer&) = delete;
+		FrameBuffer& operator=(FrameBuffer&&) noexcept = delete;
+
+		static uint32_t PackRGB(uint8_t r, uint8_t g, uint8_t b)
+		{
+			return (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | static_cast<uint32_t>(b);
+		}
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		uint32_t* GetPixels() const { return m_pPixels; }
+
+		// Called once a frame is complete
+		virtual void Present() {}
+
+		// Writes the current pixels as a 24 bit BMP, returns false when the file could not be written
+		bool SaveToBMP(const std::string& filePath) const;
+
+	protected:
+		int m_Width{};
+		int m_Height{};
+		uint32_t* m_pPixels{};
+	};
+
+	// Plain memory, for rendering without a window
+	class MemoryFrameBuffer final : public FrameBuffer
+	{
+	public:
+		MemoryFrameBuffer(int width, int height);
+		~MemoryFrameBuffer() override = default;
+
+		MemoryFrameBuffer(const MemoryFrameBuffer&) = delete;
+		MemoryFrameBuffer(MemoryFrameBuffer&&) noexcept = delete;
+		MemoryFrameBuffer& operator=(const MemoryFrameBuffer&) = delete;
+		MemoryFrameBuffer& operator=(MemoryFrameBuffer&&) noexcept = delete;
+
+	private:
+		std::vector<uint32_t> m_Pixels{};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+	MappedFile::MappedFile(const std::string& filePath)
+	{
+#if defined(_WIN32)
+		const HANDLE file{ CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+		if (file == INVALID_HANDLE_VALUE) return;
+		m_File = file;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize)) return;
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+		m_IsOpen = true;
+		// Empty files cannot be mapped
+		if (m_Size == 0) return;
+
+		m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping) m_pData = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		m_FileDescriptor = open(filePath.c_str(), O_RDONLY);
+		if (m_FileDescriptor == -1) return;
+
+		struct stat fileStatus{};
+		if (fstat(m_FileDescriptor, &fileStatus) == -1) return;
+		m_Size = static_cast<size_t>(fileStatus.st_size);
+		m_IsOpen = true;
+		// Empty files cannot be mapped
+		if (m_Size == 0) return;
+
+		void* pMapping{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0) };
+		if (pMapping != MAP_FAILED)
+		{
+			m_pData = static_cast<const char*>(pMapping);
+			madvise(pMapping, m_Size, MADV_SEQUENTIAL);
+		}
+#endif
+		if (!m_pData) m_IsOpen = false;
+	}
+
+	MappedFile::~MappedFile()
+	{
+#if defined(_WIN32)
+		if (m_pData) UnmapViewOfFile(m_pData);
+		if (m_Mapping) CloseHandle(m_Mapping);
+		if (m_File) CloseHandle(m_File);
+#else
+		if (m_pData) munmap(const_cast<char*>(m_pData), m_Size);
+		if (m_FileDescriptor != -1) close(m_FileDescriptor);
+#endif
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace dae
+{
+	/**
+	 * \brief Read-only view of a whole file through the OS page cache, unmapped when it goes out of scope
+	 * An empty file is open but has no data
+	 */
+	class MappedFile final
+	{
+	public:
+		explicit MappedFile(const std::string& filePath);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		bool IsOpen() const { return m_IsOpen; }
+		const char* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+#if defined(_WIN32)
+		// HANDLEs, kept out of the header so windows.h is not pulled in everywhere
+		void* m_File{};
+		void* m_Mapping{};
+#else
+		int m_FileDescriptor{ -1 };
+#endif
+		const char* m_pData{};
+		size_t m_Size{};
+		bool m_IsOpen{ false };
+	};
+}
\ No newline at end of file
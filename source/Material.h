@@ -1,21 +1,22 @@
 #pragma once
+#include <variant>
+
 #include "Math.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
 
 namespace dae
 {
-#pragma region Material BASE
-	class Material
+	// The materials are plain value types: the scene stores them in a closed variant, so shading is a switch instead of a virtual call
+#pragma region Material SOLID COLOR
+	//SOLID COLOR
+	//===========
+	class Material_SolidColor final
 	{
 	public:
-		Material() = default;
-		virtual ~Material() = default;
-
-		Material(const Material&) = delete;
-		Material(Material&&) noexcept = delete;
-		Material& operator=(const Material&) = delete;
-		Material& operator=(Material&&) noexcept = delete;
+		Material_SolidColor(const ColorRGB& color): m_Color(color)
+		{
+		}
 
 		/**
 		 * \brief Function used to calculate the correct color for the specific material and its parameters
@@ -24,23 +25,14 @@ namespace dae
 		 * \param v view direction
 		 * \return color
 		 */
-		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
-	};
-#pragma endregion
-
-#pragma region Material SOLID COLOR
-	//SOLID COLOR
-	//===========
-	class Material_SolidColor final : public Material
-	{
-	public:
-		Material_SolidColor(const ColorRGB& color): m_Color(color)
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
 		{
+			return m_Color;
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) override
+		void ShadeBatch(const ShadingBatch& batch, ColorRGB* pColors) const
 		{
-			return m_Color;
+			std::fill_n(pColors, batch.count, m_Color);
 		}
 
 	private:
@@ -51,17 +43,21 @@ namespace dae
 #pragma region Material LAMBERT
 	//LAMBERT
 	//=======
-	class Material_Lambert final : public Material
+	class Material_Lambert final
 	{
 	public:
 		Material_Lambert(const ColorRGB& diffuseColor, float diffuseReflectance) :
 			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(diffuseReflectance){}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) const
 		{
 			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
-			//todo: W3
-			return {};
+		}
+
+		// Lambert does not depend on the directions, so a batch is a single evaluation
+		void ShadeBatch(const ShadingBatch& batch, ColorRGB* pColors) const
+		{
+			std::fill_n(pColors, batch.count, Shade());
 		}
 
 	private:
@@ -73,7 +69,7 @@ namespace dae
 #pragma region Material LAMBERT PHONG
 	//LAMBERT-PHONG
 	//=============
-	class Material_LambertPhong final : public Material
+	class Material_LambertPhong final
 	{
 	public:
 		Material_LambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent):
@@ -82,11 +78,18 @@ namespace dae
 		{
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) const
 		{
-			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor) + BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, v, hitRecord.normal);
-			//todo: W3
-			return {};
+			return Evaluate(BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor), hitRecord.normal, l, v);
+		}
+
+		void ShadeBatch(const ShadingBatch& batch, ColorRGB* pColors) const
+		{
+			const ColorRGB diffuse{ BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor) };
+			for (uint32_t i{ 0 }; i < batch.count; ++i)
+			{
+				pColors[i] = Evaluate(diffuse, batch.GetNormal(i), batch.GetLightDirection(i), batch.GetViewDirection(i));
+			}
 		}
 
 	private:
@@ -94,43 +97,58 @@ namespace dae
 		float m_DiffuseReflectance{0.5f}; //kd
 		float m_SpecularReflectance{0.5f}; //ks
 		float m_PhongExponent{1.f}; //Phong Exponent
+
+		ColorRGB Evaluate(ColorRGB diffuse, const Vector3& n, const Vector3& l, const Vector3& v) const
+		{
+			return diffuse + BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, v, n);
+		}
 	};
 #pragma endregion
 
 #pragma region Material COOK TORRENCE
 	//COOK TORRENCE
-	class Material_CookTorrence final : public Material
+	class Material_CookTorrence final
 	{
 	public:
+		/**
+		 * \param metalness Anything above 0 is a metal (no diffuse term, albedo as base reflectivity)
+		 * \param roughness [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		 */
 		Material_CookTorrence(const ColorRGB& albedo, float metalness, float roughness):
-			m_Albedo(albedo), m_Metalness(metalness), m_Roughness(roughness)
+			m_Constants(albedo, metalness, roughness)
+		{
+		}
+
+		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) const
 		{
+			return BRDF::CookTorrance(m_Constants, hitRecord.normal, l, v);
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		void ShadeBatch(const ShadingBatch& batch, ColorRGB* pColors) const
 		{
-			ColorRGB f0 = (m_Metalness <= FLT_EPSILON) ? ColorRGB{ 0.04f,0.04f,0.04f } : m_Albedo;
-			const ColorRGB fresnel = BRDF::FresnelFunction_Schlick(helperFuncts::HalfVector(l, -v), -v, f0);
-			//return BRDF::FresnelFunction_Schlick(helperFuncts::HalfVector(l,-v),-v,f0);
-			float norm = BRDF::NormalDistribution_GGX(hitRecord.normal, helperFuncts::HalfVector(l, -v), m_Roughness);
-			//return {norm,norm,norm};
-			float geometry = BRDF::GeometryFunction_Smith(hitRecord.normal, -v,l, m_Roughness);
-			//return { geometry,geometry,geometry };
-			ColorRGB DFG = fresnel * norm * geometry;
-			float denominator = (4 * (Vector3::DotClamp(-v, hitRecord.normal) * Vector3::DotClamp(l, hitRecord.normal)));
-			ColorRGB specular = DFG / std::max(denominator, 0.000001f);
-
-			ColorRGB kd = (m_Metalness <= FLT_EPSILON) ? ColorRGB{1,1,1} - fresnel : ColorRGB{0, 0, 0};
-			ColorRGB diffuse = BRDF::Lambert(kd, m_Albedo);
-			return diffuse + specular;
-			//todo: W3
-			return {};
+			BRDF::CookTorrance(m_Constants, batch, pColors);
 		}
 
 	private:
-		ColorRGB m_Albedo{0.955f, 0.637f, 0.538f}; //Copper
-		float m_Metalness{1.0f};
-		float m_Roughness{0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		// Everything Shade needs from albedo, metalness and roughness, derived once in the constructor
+		BRDF::CookTorranceConstants m_Constants;
 	};
 #pragma endregion
-}
+
+	// Closed set of materials, stored by value in the scene
+	using Material = std::variant<Material_SolidColor, Material_Lambert, Material_LambertPhong, Material_CookTorrence>;
+
+	namespace MaterialUtils
+	{
+		inline ColorRGB Shade(const Material& material, const HitRecord& hitRecord, const Vector3& l, const Vector3& v)
+		{
+			return std::visit([&](const auto& typedMaterial) { return typedMaterial.Shade(hitRecord, l, v); }, material);
+		}
+
+		// Dispatches once and lets the material run its own loop over the whole batch
+		inline void ShadeBatch(const Material& material, const ShadingBatch& batch, ColorRGB* pColors)
+		{
+			std::visit([&](const auto& typedMaterial) { typedMaterial.ShadeBatch(batch, pColors); }, material);
+		}
+	}
+}
\ No newline at end of file
@@ -1,51 +1,223 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+
+#include "Float4.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
 namespace dae {
+	// Header only like the vectors, the row operations run on Float4 (summed in the same order as per component)
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-		const Matrix& Transpose();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v[0], v[1], v[2]);
+		}
+
+		Vector3 TransformVector(float x, float y, float z) const
+		{
+			const Float4 result{ GetRow(0) * Float4::Splat(x) + GetRow(1) * Float4::Splat(y) + GetRow(2) * Float4::Splat(z) };
+			return ToVector3(result);
+		}
+
+		Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p[0], p[1], p[2]);
+		}
+
+		Vector3 TransformPoint(float x, float y, float z) const
+		{
+			const Float4 result{ GetRow(0) * Float4::Splat(x) + GetRow(1) * Float4::Splat(y) + GetRow(2) * Float4::Splat(z) + GetRow(3) };
+			return ToVector3(result);
+		}
+
+		constexpr const Matrix& Transpose()
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			*this = result;
+			return *this;
+		}
+
+		constexpr Vector3 GetAxisX() const
+		{
+			return data[0];
+		}
+
+		constexpr Vector3 GetAxisY() const
+		{
+			return data[1];
+		}
+
+		constexpr Vector3 GetAxisZ() const
+		{
+			return data[2];
+		}
+
+		constexpr Vector3 GetTranslation() const
+		{
+			return data[3];
+		}
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			return CreateTranslation({ x, y, z });
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			Matrix matrix{};
+
+			matrix[1][1] = cosf(pitch);
+			matrix[1][2] = -sinf(pitch);
+			matrix[2][1] = sinf(pitch);
+			matrix[2][2] = cosf(pitch);
+
+			return matrix;
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			Matrix matrix{};
+
+			matrix[0][0] = cosf(yaw);
+			matrix[0][2] = -sinf(yaw);
+			matrix[2][0] = sinf(yaw);
+			matrix[2][2] = cosf(yaw);
+
+			return matrix;
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			Matrix matrix{};
+
+			matrix[0][0] = cosf(roll);
+			matrix[0][1] = sinf(roll);
+			matrix[1][0] = -sinf(roll);
+			matrix[1][1] = cosf(roll);
+
+			return matrix;
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return CreateRotationX(r.x) * CreateRotationY(r.y) * CreateRotationZ(r.z);
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			Matrix matrix{};
+
+			matrix[0][0] = sx;
+			matrix[1][1] = sy;
+			matrix[2][2] = sz;
+
+			return matrix;
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s[0], s[1], s[2]);
+		}
+
+		static constexpr Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		static constexpr Matrix Inverse(const Matrix& m)
+		{
+			// Affine only (last column is 0,0,0,1): invert the 3x3 part with cross products, then undo the translation
+			const Vector3 a{ m[0] };
+			const Vector3 b{ m[1] };
+			const Vector3 c{ m[2] };
+			const Vector3 t{ m[3] };
+
+			const Vector3 bc{ Vector3::Cross(b, c) };
+			const Vector3 ca{ Vector3::Cross(c, a) };
+			const Vector3 ab{ Vector3::Cross(a, b) };
+			const float inverseDeterminant{ 1.f / Vector3::Dot(a, bc) };
+
+			const Vector3 xAxis{ bc.x * inverseDeterminant, ca.x * inverseDeterminant, ab.x * inverseDeterminant };
+			const Vector3 yAxis{ bc.y * inverseDeterminant, ca.y * inverseDeterminant, ab.y * inverseDeterminant };
+			const Vector3 zAxis{ bc.z * inverseDeterminant, ca.z * inverseDeterminant, ab.z * inverseDeterminant };
+			const Vector3 translation{ -(t.x * xAxis + t.y * yAxis + t.z * zAxis) };
+
+			return { xAxis, yAxis, zAxis, translation };
+		}
+
+		constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		Matrix operator*(const Matrix& m) const
+		{
+			// Row r of the product combines the rows of m weighted by row r of this matrix
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				const Float4 row{ m.GetRow(0) * Float4::Splat(data[r].x) + m.GetRow(1) * Float4::Splat(data[r].y)
+					+ m.GetRow(2) * Float4::Splat(data[r].z) + m.GetRow(3) * Float4::Splat(data[r].w) };
+				row.Store(&result.data[r].x);
+			}
+
+			return result;
+		}
+
+		const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
 
 	private:
 
@@ -62,5 +234,17 @@ namespace dae {
 		// v1x v1y v1z v1w
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
+
+		Float4 GetRow(int index) const
+		{
+			return Float4::Load(&data[index].x);
+		}
+
+		static Vector3 ToVector3(const Float4& row)
+		{
+			float values[4];
+			row.Store(values);
+			return { values[0], values[1], values[2] };
+		}
 	};
 }
\ No newline at end of file
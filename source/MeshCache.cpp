@@ -0,0 +1,268 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "DataTypes.h"
+#include "MappedFile.h"
+#include "Trace.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace MeshCache
+	{
+		namespace
+		{
+			constexpr char g_Magic[8]{ 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+			// Bump whenever the layout of the file or the way the BVH is built changes
+			constexpr uint32_t g_FormatVersion{ 4 };
+			constexpr size_t g_SectionAlignment{ 64 };
+
+			// Which of the two triangle sections this build fills and traverses, the other one stays empty
+			enum class TriangleLayout : uint32_t
+			{
+				Records,
+				Blocks
+			};
+#ifdef USE_TRIANGLE_BLOCKS
+			constexpr TriangleLayout g_TriangleLayout{ TriangleLayout::Blocks };
+#else
+			constexpr TriangleLayout g_TriangleLayout{ TriangleLayout::Records };
+#endif
+
+			constexpr uint64_t g_FNVOffsetBasis{ 14695981039346656037ull };
+			constexpr uint64_t g_FNVPrime{ 1099511628211ull };
+
+			enum class SectionType : uint32_t
+			{
+				Positions,
+				Normals,
+				Indices,
+				BVHNodes,
+				BVHPrimitiveIndices,
+				WideBVHNodes,
+				TriangleBlocks,
+				TriangleBlockNodeFirstBlock,
+				TriangleRecords,
+
+				Count
+			};
+			constexpr uint32_t g_NrSections{ static_cast<uint32_t>(SectionType::Count) };
+
+			struct Section
+			{
+				uint64_t offset;
+				uint64_t count;
+			};
+
+			struct Header
+			{
+				char magic[8];
+				uint32_t formatVersion;
+				uint32_t leafBlockSize;
+				uint64_t sourceHash;
+				float bvhBuildCost;
+				TriangleLayout triangleLayout;
+				// Sizes of the stored structs, a cache written by a build with another layout is stale as well
+				uint32_t elementSizes[g_NrSections];
+				Section sections[g_NrSections];
+			};
+
+			constexpr uint32_t g_ElementSizes[g_NrSections]
+			{
+				sizeof(Vector3),
+				sizeof(Vector3),
+				sizeof(int),
+				sizeof(BVHNode),
+				sizeof(uint32_t),
+				sizeof(WideBVHNode),
+				sizeof(TriangleBlock),
+				sizeof(uint32_t),
+				sizeof(TriangleRecord)
+			};
+
+			uint64_t AlignOffset(uint64_t offset)
+			{
+				return (offset + g_SectionAlignment - 1) / g_SectionAlignment * g_SectionAlignment;
+			}
+
+			// Bulk copy of a section, the offsets are aligned so the mapped data can be read in place
+			template<typename T>
+			void CopySection(const char* pData, const Section& section, std::vector<T>& elements)
+			{
+				const T* pFirst{ reinterpret_cast<const T*>(pData + section.offset) };
+				elements.assign(pFirst, pFirst + section.count);
+			}
+		}
+
+		bool LoadOBJ(const std::string& filePath, TriangleMesh& mesh, ThreadPool* pThreadPool)
+		{
+			TRACE_ZONE("MeshCache::LoadOBJ");
+			uint64_t sourceHash{};
+			{
+				const MappedFile sourceFile{ filePath };
+				if (!sourceFile.IsOpen()) return false;
+				sourceHash = HashContent(sourceFile.GetData(), sourceFile.GetSize());
+			}
+
+			const std::string cachePath{ filePath + ".meshcache" };
+			if (Read(cachePath, sourceHash, mesh)) return true;
+
+			mesh.positions.clear();
+			mesh.normals.clear();
+			mesh.indices.clear();
+			if (!Utils::ParseOBJ(filePath, mesh.positions, mesh.normals, mesh.indices, pThreadPool)) return false;
+			mesh.UpdateGeometry();
+
+			if (!Write(cachePath, sourceHash, mesh))
+			{
+				std::cout << "Could not write mesh cache " << cachePath << '\n';
+			}
+			return true;
+		}
+
+		bool Write(const std::string& cachePath, uint64_t sourceHash, const TriangleMesh& mesh)
+		{
+			Header header{};
+			std::memcpy(header.magic, g_Magic, sizeof(g_Magic));
+			header.formatVersion = g_FormatVersion;
+			header.leafBlockSize = mesh.bvh.leafBlockSize;
+			header.sourceHash = sourceHash;
+			header.bvhBuildCost = mesh.bvh.buildCost;
+			header.triangleLayout = g_TriangleLayout;
+			std::memcpy(header.elementSizes, g_ElementSizes, sizeof(g_ElementSizes));
+
+			const void* sectionData[g_NrSections]
+			{
+				mesh.positions.data(),
+				mesh.normals.data(),
+				mesh.indices.data(),
+				mesh.bvh.nodes.data(),
+				mesh.bvh.primitiveIndices.data(),
+				mesh.wideBVH.nodes.data(),
+				mesh.triangleBlocks.blocks.data(),
+				mesh.triangleBlocks.nodeFirstBlock.data(),
+				mesh.triangleRecords.records.data()
+			};
+			const size_t sectionCounts[g_NrSections]
+			{
+				mesh.positions.size(),
+				mesh.normals.size(),
+				mesh.indices.size(),
+				mesh.bvh.nodes.size(),
+				mesh.bvh.primitiveIndices.size(),
+				mesh.wideBVH.nodes.size(),
+				mesh.triangleBlocks.blocks.size(),
+				mesh.triangleBlocks.nodeFirstBlock.size(),
+				mesh.triangleRecords.records.size()
+			};
+
+			uint64_t offset{ AlignOffset(sizeof(Header)) };
+			for (uint32_t i{ 0 }; i < g_NrSections; ++i)
+			{
+				header.sections[i] = { offset, sectionCounts[i] };
+				offset = AlignOffset(offset + sectionCounts[i] * g_ElementSizes[i]);
+			}
+
+			std::ofstream file{ cachePath, std::ios::binary };
+			if (!file) return false;
+
+			const char padding[g_SectionAlignment]{};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			uint64_t writtenSize{ sizeof(Header) };
+			for (uint32_t i{ 0 }; i < g_NrSections; ++i)
+			{
+				file.write(padding, static_cast<std::streamsize>(header.sections[i].offset - writtenSize));
+				const uint64_t sectionSize{ header.sections[i].count * g_ElementSizes[i] };
+				file.write(static_cast<const char*>(sectionData[i]), static_cast<std::streamsize>(sectionSize));
+				writtenSize = header.sections[i].offset + sectionSize;
+			}
+			return file.good();
+		}
+
+		bool Read(const std::string& cachePath, uint64_t sourceHash, TriangleMesh& mesh)
+		{
+			const MappedFile file{ cachePath };
+			if (!file.IsOpen() || file.GetSize() < sizeof(Header)) return false;
+
+			Header header{};
+			std::memcpy(&header, file.GetData(), sizeof(Header));
+			if (std::memcmp(header.magic, g_Magic, sizeof(g_Magic)) != 0
+				|| header.formatVersion != g_FormatVersion
+				|| header.sourceHash != sourceHash
+				|| header.triangleLayout != g_TriangleLayout
+				|| std::memcmp(header.elementSizes, g_ElementSizes, sizeof(g_ElementSizes)) != 0)
+			{
+				return false;
+			}
+
+			// A truncated file would otherwise be read past its end
+			for (uint32_t i{ 0 }; i < g_NrSections; ++i)
+			{
+				const Section& section{ header.sections[i] };
+				if (section.offset % g_SectionAlignment != 0 || section.offset > file.GetSize()
+					|| section.count > (file.GetSize() - section.offset) / g_ElementSizes[i])
+				{
+					return false;
+				}
+			}
+
+			const auto getSection = [&](SectionType sectionType) -> const Section&
+				{
+					return header.sections[static_cast<uint32_t>(sectionType)];
+				};
+
+			const char* pData{ file.GetData() };
+			CopySection(pData, getSection(SectionType::Positions), mesh.positions);
+			CopySection(pData, getSection(SectionType::Normals), mesh.normals);
+			CopySection(pData, getSection(SectionType::Indices), mesh.indices);
+			CopySection(pData, getSection(SectionType::BVHNodes), mesh.bvh.nodes);
+			CopySection(pData, getSection(SectionType::BVHPrimitiveIndices), mesh.bvh.primitiveIndices);
+			CopySection(pData, getSection(SectionType::WideBVHNodes), mesh.wideBVH.nodes);
+			CopySection(pData, getSection(SectionType::TriangleBlocks), mesh.triangleBlocks.blocks);
+			CopySection(pData, getSection(SectionType::TriangleBlockNodeFirstBlock), mesh.triangleBlocks.nodeFirstBlock);
+			CopySection(pData, getSection(SectionType::TriangleRecords), mesh.triangleRecords.records);
+			mesh.bvh.leafBlockSize = header.leafBlockSize;
+			mesh.bvh.buildCost = header.bvhBuildCost;
+
+			// Same bounds UpdateGeometry would have set
+			if (!mesh.bvh.IsEmpty())
+			{
+				mesh.minAABB = mesh.bvh.nodes[0].minAABB;
+				mesh.maxAABB = mesh.bvh.nodes[0].maxAABB;
+			}
+			return true;
+		}
+
+		uint64_t HashContent(const char* pData, size_t size)
+		{
+			constexpr size_t nrLanes{ 4 };
+			uint64_t lanes[nrLanes]{ g_FNVOffsetBasis, g_FNVOffsetBasis, g_FNVOffsetBasis, g_FNVOffsetBasis };
+
+			size_t offset{ 0 };
+			for (; offset + nrLanes * sizeof(uint64_t) <= size; offset += nrLanes * sizeof(uint64_t))
+			{
+				for (size_t lane{ 0 }; lane < nrLanes; ++lane)
+				{
+					uint64_t word{};
+					std::memcpy(&word, pData + offset + lane * sizeof(uint64_t), sizeof(uint64_t));
+					lanes[lane] = (lanes[lane] ^ word) * g_FNVPrime;
+				}
+			}
+
+			uint64_t hash{ g_FNVOffsetBasis };
+			for (const uint64_t lane : lanes)
+			{
+				hash = (hash ^ lane) * g_FNVPrime;
+			}
+			for (; offset < size; ++offset)
+			{
+				hash = (hash ^ static_cast<uint8_t>(pData[offset])) * g_FNVPrime;
+			}
+			return hash;
+		}
+	}
+}
\ No newline at end of file
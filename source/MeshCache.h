@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	struct TriangleMesh;
+	class ThreadPool;
+
+	/**
+	 * \brief Binary copy of a parsed mesh and its prebuilt acceleration structure, stored next to the source asset
+	 * Every array is a 64 byte aligned section of the file, so loading is a mapping and one bulk copy per array
+	 */
+	namespace MeshCache
+	{
+		/**
+		 * \brief Loads an OBJ through its cache (<filePath>.meshcache)
+		 * A missing or stale cache (other content hash, format version, struct layout or triangle layout) is replaced: the OBJ is parsed, its BVH built and the cache written again
+		 * The mesh ends up as after ParseOBJ + UpdateGeometry: positions, face normals, indices, BVH, wide BVH and triangle blocks
+		 * \param pThreadPool Parses the OBJ in chunks on the pool when given, not for calls from inside a Dispatch of that same pool
+		 * \return false when the OBJ itself could not be loaded, a cache that cannot be written only costs the next start a parse
+		 */
+		bool LoadOBJ(const std::string& filePath, TriangleMesh& mesh, ThreadPool* pThreadPool = nullptr);
+
+		bool Write(const std::string& cachePath, uint64_t sourceHash, const TriangleMesh& mesh);
+		// Returns false, leaving the mesh untouched, when the cache is missing, damaged or stale
+		bool Read(const std::string& cachePath, uint64_t sourceHash, TriangleMesh& mesh);
+
+		// 64 bit FNV-1a over 8 byte words in four interleaved lanes (a single chain is bound by the multiply latency), the tail byte by byte
+		uint64_t HashContent(const char* pData, size_t size);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "OBJLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+namespace dae
+{
+	namespace OBJLoader
+	{
+		namespace
+		{
+			// A range of whole lines, with what it holds and where its elements go in the mesh
+			struct Chunk
+			{
+				const char* pBegin{};
+				const char* pEnd{};
+
+				size_t nrPositions{};
+				size_t nrTexCoords{};
+				size_t nrNormals{};
+				size_t nrTriangles{};
+
+				size_t firstPosition{};
+				size_t firstTexCoord{};
+				size_t firstNormal{};
+				size_t firstTriangle{};
+
+				bool isValid{ true };
+			};
+
+			// Files below this size are not worth splitting up
+			constexpr size_t g_MinChunkSize{ 1 << 20 };
+
+			enum class LineType
+			{
+				Other,
+				Position,
+				TexCoord,
+				Normal,
+				Face
+			};
+
+			bool IsSpace(char character)
+			{
+				return character == ' ' || character == '\t' || character == '\r';
+			}
+
+			void SkipSpaces(const char*& pCurrent, const char* pLineEnd)
+			{
+				while (pCurrent < pLineEnd && IsSpace(*pCurrent)) ++pCurrent;
+			}
+
+			// Either the end of the line or the start of a trailing comment
+			bool IsLineDone(const char* pCurrent, const char* pLineEnd)
+			{
+				return pCurrent == pLineEnd || *pCurrent == '#';
+			}
+
+			const char* FindLineEnd(const char* pCurrent, const char* pEnd)
+			{
+				const void* pNewLine{ std::memchr(pCurrent, '\n', static_cast<size_t>(pEnd - pCurrent)) };
+				return pNewLine ? static_cast<const char*>(pNewLine) : pEnd;
+			}
+
+			// Moves past the keyword of the line
+			LineType ReadLineType(const char*& pCurrent, const char* pLineEnd)
+			{
+				SkipSpaces(pCurrent, pLineEnd);
+				const auto isKeyword = [&](const char* keyword, size_t length)
+					{
+						return static_cast<size_t>(pLineEnd - pCurrent) > length && std::memcmp(pCurrent, keyword, length) == 0 && IsSpace(pCurrent[length]);
+					};
+
+				if (isKeyword("v", 1))
+				{
+					pCurrent += 1;
+					return LineType::Position;
+				}
+				if (isKeyword("vt", 2))
+				{
+					pCurrent += 2;
+					return LineType::TexCoord;
+				}
+				if (isKeyword("vn", 2))
+				{
+					pCurrent += 2;
+					return LineType::Normal;
+				}
+				if (isKeyword("f", 1))
+				{
+					pCurrent += 1;
+					return LineType::Face;
+				}
+				return LineType::Other;
+			}
+
+			bool ParseFloat(const char*& pCurrent, const char* pLineEnd, float& value)
+			{
+				SkipSpaces(pCurrent, pLineEnd);
+				// from_chars does not take an explicit plus sign
+				if (pCurrent < pLineEnd && *pCurrent == '+') ++pCurrent;
+
+				const auto [pNext, error] { std::from_chars(pCurrent, pLineEnd, value) };
+				if (error != std::errc{}) return false;
+				pCurrent = pNext;
+				return true;
+			}
+
+			// One-based, negative ones count back from the last element defined so far
+			bool ParseIndex(const char*& pCurrent, const char* pLineEnd, size_t nrDefined, int& index)
+			{
+				long long value{};
+				const auto [pNext, error] { std::from_chars(pCurrent, pLineEnd, value) };
+				if (error != std::errc{} || value == 0) return false;
+				pCurrent = pNext;
+
+				const long long zeroBasedIndex{ value > 0 ? value - 1 : static_cast<long long>(nrDefined) + value };
+				if (zeroBasedIndex < 0 || zeroBasedIndex > INT32_MAX) return false;
+				index = static_cast<int>(zeroBasedIndex);
+				return true;
+			}
+
+			struct Corner
+			{
+				int position{ -1 };
+				int texCoord{ -1 };
+				int normal{ -1 };
+			};
+
+			// v, v/vt, v//vn or v/vt/vn
+			bool ParseCorner(const char*& pCurrent, const char* pLineEnd, size_t nrPositions, size_t nrTexCoords, size_t nrNormals, Corner& corner)
+			{
+				corner = {};
+				if (!ParseIndex(pCurrent, pLineEnd, nrPositions, corner.position)) return false;
+				if (pCurrent == pLineEnd || *pCurrent != '/') return true;
+
+				++pCurrent;
+				if (pCurrent < pLineEnd && *pCurrent != '/' && !ParseIndex(pCurrent, pLineEnd, nrTexCoords, corner.texCoord)) return false;
+				if (pCurrent == pLineEnd || *pCurrent != '/') return true;
+
+				++pCurrent;
+				return ParseIndex(pCurrent, pLineEnd, nrNormals, corner.normal);
+			}
+
+			size_t CountCorners(const char* pCurrent, const char* pLineEnd)
+			{
+				size_t nrCorners{ 0 };
+				SkipSpaces(pCurrent, pLineEnd);
+				while (!IsLineDone(pCurrent, pLineEnd))
+				{
+					++nrCorners;
+					while (pCurrent < pLineEnd && !IsSpace(*pCurrent)) ++pCurrent;
+					SkipSpaces(pCurrent, pLineEnd);
+				}
+				return nrCorners;
+			}
+
+			void CountChunk(Chunk& chunk)
+			{
+				for (const char* pLine{ chunk.pBegin }; pLine < chunk.pEnd;)
+				{
+					const char* pLineEnd{ FindLineEnd(pLine, chunk.pEnd) };
+					const char* pCurrent{ pLine };
+					switch (ReadLineType(pCurrent, pLineEnd))
+					{
+					case LineType::Position:
+						++chunk.nrPositions;
+						break;
+					case LineType::TexCoord:
+						++chunk.nrTexCoords;
+						break;
+					case LineType::Normal:
+						++chunk.nrNormals;
+						break;
+					case LineType::Face:
+					{
+						const size_t nrCorners{ CountCorners(pCurrent, pLineEnd) };
+						if (nrCorners >= 3) chunk.nrTriangles += nrCorners - 2;
+						break;
+					}
+					default:
+						break;
+					}
+					pLine = pLineEnd + 1;
+				}
+			}
+
+			bool ParseChunk(const Chunk& chunk, OBJMesh& mesh)
+			{
+				size_t positionIndex{ chunk.firstPosition };
+				size_t texCoordIndex{ chunk.firstTexCoord };
+				size_t normalIndex{ chunk.firstNormal };
+				size_t cornerIndex{ chunk.firstTriangle * 3 };
+
+				for (const char* pLine{ chunk.pBegin }; pLine < chunk.pEnd;)
+				{
+					const char* pLineEnd{ FindLineEnd(pLine, chunk.pEnd) };
+					const char* pCurrent{ pLine };
+					switch (ReadLineType(pCurrent, pLineEnd))
+					{
+					case LineType::Position:
+					{
+						Vector3& position{ mesh.positions[positionIndex++] };
+						if (!ParseFloat(pCurrent, pLineEnd, position.x) || !ParseFloat(pCurrent, pLineEnd, position.y) || !ParseFloat(pCurrent, pLineEnd, position.z)) return false;
+						break;
+					}
+					case LineType::TexCoord:
+					{
+						OBJTexCoord& texCoord{ mesh.texCoords[texCoordIndex++] };
+						if (!ParseFloat(pCurrent, pLineEnd, texCoord.u)) return false;
+						// v is optional
+						SkipSpaces(pCurrent, pLineEnd);
+						if (!IsLineDone(pCurrent, pLineEnd) && !ParseFloat(pCurrent, pLineEnd, texCoord.v)) return false;
+						break;
+					}
+					case LineType::Normal:
+					{
+						Vector3& normal{ mesh.normals[normalIndex++] };
+						if (!ParseFloat(pCurrent, pLineEnd, normal.x) || !ParseFloat(pCurrent, pLineEnd, normal.y) || !ParseFloat(pCurrent, pLineEnd, normal.z)) return false;
+						break;
+					}
+					case LineType::Face:
+					{
+						// Triangulated as a fan around the first corner
+						Corner firstCorner{}, previousCorner{}, corner{};
+						size_t nrCorners{ 0 };
+						SkipSpaces(pCurrent, pLineEnd);
+						while (!IsLineDone(pCurrent, pLineEnd))
+						{
+							if (!ParseCorner(pCurrent, pLineEnd, positionIndex, texCoordIndex, normalIndex, corner)) return false;
+							if (pCurrent < pLineEnd && !IsSpace(*pCurrent)) return false;
+							SkipSpaces(pCurrent, pLineEnd);
+
+							if (nrCorners == 0) firstCorner = corner;
+							else if (nrCorners >= 2)
+							{
+								for (const Corner& triangleCorner : { firstCorner, previousCorner, corner })
+								{
+									mesh.positionIndices[cornerIndex] = triangleCorner.position;
+									mesh.texCoordIndices[cornerIndex] = triangleCorner.texCoord;
+									mesh.normalIndices[cornerIndex] = triangleCorner.normal;
+									++cornerIndex;
+								}
+							}
+							previousCorner = corner;
+							++nrCorners;
+						}
+						break;
+					}
+					default:
+						break;
+					}
+					pLine = pLineEnd + 1;
+				}
+				return true;
+			}
+
+			bool AreIndicesValid(const std::vector<int>& indices, size_t nrElements)
+			{
+				for (const int index : indices)
+				{
+					if (index >= static_cast<int>(nrElements)) return false;
+				}
+				return true;
+			}
+		}
+
+		bool Load(const std::string& filePath, OBJMesh& mesh, ThreadPool* pThreadPool)
+		{
+			TRACE_ZONE("OBJLoader::Load");
+			mesh = {};
+
+			const MappedFile file{ filePath };
+			if (!file.IsOpen()) return false;
+			if (file.GetSize() == 0) return true;
+
+			// Chunks start right after a line end, so no line is split between two of them
+			const char* pData{ file.GetData() };
+			const char* pDataEnd{ pData + file.GetSize() };
+			const size_t nrChunks{ pThreadPool ? std::max<size_t>(std::min<size_t>(file.GetSize() / g_MinChunkSize, pThreadPool->GetNrThreads() * 4), 1) : 1 };
+			std::vector<Chunk> chunks(nrChunks);
+			const char* pChunkBegin{ pData };
+			for (size_t i{ 0 }; i < nrChunks; ++i)
+			{
+				const char* pChunkEnd{ i + 1 == nrChunks ? pDataEnd : std::max(pChunkBegin, pData + file.GetSize() / nrChunks * (i + 1)) };
+				if (pChunkEnd < pDataEnd) pChunkEnd = std::min(FindLineEnd(pChunkEnd, pDataEnd) + 1, pDataEnd);
+
+				chunks[i].pBegin = pChunkBegin;
+				chunks[i].pEnd = pChunkEnd;
+				pChunkBegin = pChunkEnd;
+			}
+
+			const auto forEachChunk = [&](const std::function<void(unsigned int)>& task)
+				{
+					if (pThreadPool && nrChunks > 1)
+					{
+						pThreadPool->Dispatch(static_cast<unsigned int>(nrChunks), task);
+						return;
+					}
+					for (unsigned int i{ 0 }; i < nrChunks; ++i) task(i);
+				};
+
+			forEachChunk([&](unsigned int chunkIndex) { CountChunk(chunks[chunkIndex]); });
+
+			// Every chunk writes behind the elements of the chunks before it
+			size_t nrPositions{ 0 }, nrTexCoords{ 0 }, nrNormals{ 0 }, nrTriangles{ 0 };
+			for (Chunk& chunk : chunks)
+			{
+				chunk.firstPosition = nrPositions;
+				chunk.firstTexCoord = nrTexCoords;
+				chunk.firstNormal = nrNormals;
+				chunk.firstTriangle = nrTriangles;
+				nrPositions += chunk.nrPositions;
+				nrTexCoords += chunk.nrTexCoords;
+				nrNormals += chunk.nrNormals;
+				nrTriangles += chunk.nrTriangles;
+			}
+			mesh.positions.resize(nrPositions);
+			mesh.texCoords.resize(nrTexCoords);
+			mesh.normals.resize(nrNormals);
+			mesh.positionIndices.resize(nrTriangles * 3);
+			mesh.texCoordIndices.resize(nrTriangles * 3);
+			mesh.normalIndices.resize(nrTriangles * 3);
+
+			forEachChunk([&](unsigned int chunkIndex) { chunks[chunkIndex].isValid = ParseChunk(chunks[chunkIndex], mesh); });
+
+			for (const Chunk& chunk : chunks)
+			{
+				if (!chunk.isValid) return false;
+			}
+			// Positive indices can point ahead, so they are only checked once everything is read
+			return AreIndicesValid(mesh.positionIndices, nrPositions)
+				&& AreIndicesValid(mesh.texCoordIndices, nrTexCoords)
+				&& AreIndicesValid(mesh.normalIndices, nrNormals);
+		}
+	}
+}
\ No newline at end of file
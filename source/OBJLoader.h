@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	struct OBJTexCoord
+	{
+		float u{};
+		float v{};
+	};
+
+	/**
+	 * \brief Geometry of an OBJ file, every face triangulated as a fan
+	 * The index lists hold three zero-based entries per triangle, texture and normal indices are -1 for corners that have none
+	 */
+	struct OBJMesh
+	{
+		std::vector<Vector3> positions{};
+		std::vector<OBJTexCoord> texCoords{};
+		std::vector<Vector3> normals{};
+
+		std::vector<int> positionIndices{};
+		std::vector<int> texCoordIndices{};
+		std::vector<int> normalIndices{};
+	};
+
+	namespace OBJLoader
+	{
+		/**
+		 * \brief Reads v, vt, vn and f (v, v/vt, v//vn, v/vt/vn, negative indices, any number of corners), skips everything else
+		 * The file is memory mapped and counted first, so every array is allocated once
+		 * \param pThreadPool Counts and parses the file in chunks on the pool when given, on the calling thread otherwise
+		 * \return false when the file could not be read or holds malformed numbers or indices
+		 */
+		bool Load(const std::string& filePath, OBJMesh& mesh, ThreadPool* pThreadPool = nullptr);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	constexpr uint32_t g_PacketWidth{ 8 };
+	constexpr uint32_t g_PacketSize{ g_PacketWidth * g_PacketWidth };
+	// Below this many rays reaching a mesh, the packet is split up into single rays again
+	constexpr uint32_t g_PacketMinActiveRays{ 8 };
+
+	/**
+	 * \brief Cone of 4 planes through a shared ray origin, bounding every ray of a packet
+	 * Used to reject whole BVH nodes for a packet without testing any of its rays
+	 */
+	struct Frustum
+	{
+		Vector3 origin{};
+		// Pointing inwards
+		Vector3 planeNormals[4]{};
+		// False when the rays diverge too much (spread over a hemisphere or more) to bound them like this
+		bool isValid{ false };
+
+		/**
+		 * \brief Builds the planes between consecutive corner rays
+		 * \param cornerDirections Directions of the 4 outer rays, in winding order around the packet
+		 */
+		void Build(const Vector3& _origin, const Vector3 cornerDirections[4])
+		{
+			origin = _origin;
+			isValid = false;
+
+			const Vector3 centerDirection{ cornerDirections[0] + cornerDirections[1] + cornerDirections[2] + cornerDirections[3] };
+			for (int i{ 0 }; i < 4; ++i)
+			{
+				if (Vector3::Dot(cornerDirections[i], centerDirection) <= 0.f) return;
+			}
+
+			for (int i{ 0 }; i < 4; ++i)
+			{
+				Vector3 normal{ Vector3::Cross(cornerDirections[i], cornerDirections[(i + 1) % 4]) };
+				// Flip towards the inside, so the winding order of the corners does not matter
+				if (Vector3::Dot(normal, centerDirection) < 0.f) normal = -normal;
+				if (normal.SqrMagnitude() <= 0.f) return;
+				planeNormals[i] = normal;
+			}
+			isValid = true;
+		}
+
+		// True when the box is completely outside one of the planes, so no ray of the packet can hit it
+		bool ExcludesAABB(const Vector3& minAABB, const Vector3& maxAABB) const
+		{
+			for (const Vector3& normal : planeNormals)
+			{
+				// The corner farthest along the normal is the last one to leave the plane
+				const Vector3 farthestCorner{
+					normal.x >= 0.f ? maxAABB.x : minAABB.x,
+					normal.y >= 0.f ? maxAABB.y : minAABB.y,
+					normal.z >= 0.f ? maxAABB.z : minAABB.z };
+				if (Vector3::Dot(normal, farthestCorner - origin) < 0.f) return true;
+			}
+			return false;
+		}
+	};
+
+	/**
+	 * \brief Up to 8x8 coherent rays traced together
+	 * Either sharing an origin (a tile of camera rays) or an end point (shadow rays of a tile towards one light)
+	 */
+	struct RayPacket
+	{
+		Ray rays[g_PacketSize]{};
+		uint32_t count{};
+
+		// Directions of the 4 outer rays in winding order, every ray of the packet lies in between
+		Vector3 cornerDirections[4]{};
+		Frustum frustum{};
+
+		// Camera packets: fill in the corner directions first
+		void BuildFrustum()
+		{
+			frustum.Build(rays[0].origin, cornerDirections);
+		}
+
+		/**
+		 * \brief Builds the narrowest cone around the average direction from the apex that contains every point
+		 * Used for rays that share an end point instead of an origin (shadow rays towards one light)
+		 */
+		void BuildFrustumAroundPoints(const Vector3& apex, const Vector3* points, uint32_t nrPoints)
+		{
+			frustum.origin = apex;
+			frustum.isValid = false;
+
+			Vector3 axis{};
+			for (uint32_t i{ 0 }; i < nrPoints; ++i)
+			{
+				axis += (points[i] - apex).Normalized();
+			}
+			if (axis.Normalize() <= 0.f) return;
+
+			// Any two vectors perpendicular to the axis span the cross section of the cone
+			const Vector3 u{ Vector3::Cross(axis, std::abs(axis.x) < 0.9f ? Vector3::UnitX : Vector3::UnitY).Normalized() };
+			const Vector3 v{ Vector3::Cross(axis, u) };
+
+			float minU{ FLT_MAX }, maxU{ -FLT_MAX }, minV{ FLT_MAX }, maxV{ -FLT_MAX };
+			for (uint32_t i{ 0 }; i < nrPoints; ++i)
+			{
+				const Vector3 direction{ points[i] - apex };
+				const float distanceAlongAxis{ Vector3::Dot(direction, axis) };
+				if (distanceAlongAxis <= 0.f) return;
+
+				// Where the point lands on the plane one unit along the axis
+				const float pointU{ Vector3::Dot(direction, u) / distanceAlongAxis };
+				const float pointV{ Vector3::Dot(direction, v) / distanceAlongAxis };
+				minU = std::min(minU, pointU);
+				maxU = std::max(maxU, pointU);
+				minV = std::min(minV, pointV);
+				maxV = std::max(maxV, pointV);
+			}
+
+			// Rounding in the corner directions must never move a point outside the cone
+			constexpr float margin{ 1e-4f };
+			minU -= margin;
+			maxU += margin;
+			minV -= margin;
+			maxV += margin;
+
+			cornerDirections[0] = axis + u * minU + v * minV;
+			cornerDirections[1] = axis + u * maxU + v * minV;
+			cornerDirections[2] = axis + u * maxU + v * maxV;
+			cornerDirections[3] = axis + u * minU + v * maxV;
+			frustum.Build(apex, cornerDirections);
+		}
+	};
+}
\ No newline at end of file
@@ -1,12 +1,7 @@
-//External includes
-#include "SDL.h"
-#include "SDL_surface.h"
+#include <algorithm>
+#include <atomic>
 
-#include <thread>
-#include <future> // Async Stuff
-#include <ppl.h> // Parallel Stuff
-
-#include "Timer.h"
+#include "FrameBuffer.h"
 
 //Project includes
 #include "Renderer.h"
@@ -15,100 +10,287 @@
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
+#include "RayPacket.h"
+#include "ThreadPool.h"
+#include "ToneMapping.h"
+#include "Trace.h"
 #include <iostream>
 
 using namespace dae;
 
-//#define ASYNC
-#define PARALLEL_FOR
+namespace
+{
+	// Van der Corput sequence in the given base, a base 2 and a base 3 one together make the Halton sequence
+	float RadicalInverse(uint32_t index, uint32_t base)
+	{
+		float result{ 0.f };
+		float digitWeight{ 1.f / base };
+		while (index > 0)
+		{
+			result += (index % base) * digitWeight;
+			index /= base;
+			digitWeight /= base;
+		}
+		return result;
+	}
+}
+
+#define THREAD_POOL
 
-Renderer::Renderer(SDL_Window * pWindow) :
-	m_pWindow(pWindow),
-	m_pBuffer(SDL_GetWindowSurface(pWindow))
+Renderer::Renderer(FrameBuffer* pFrameBuffer) :
+	m_pFrameBuffer(pFrameBuffer)
 {
 	//Initialize
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	m_Width = pFrameBuffer->GetWidth();
+	m_Height = pFrameBuffer->GetHeight();
+	m_pBufferPixels = pFrameBuffer->GetPixels();
 	m_AspectRatio = m_Width / static_cast<float>(m_Height);
+	m_HDRPixels.resize(static_cast<size_t>(m_Width) * m_Height);
+	m_PixelCosts.resize(static_cast<size_t>(m_Width) * m_Height);
+
+	// Created once, every frame only wakes the threads up again
+	m_pThreadPool = new ThreadPool();
 }
 
-void Renderer::Render(Scene* pScene) const
+Renderer::~Renderer()
+{
+	delete m_pThreadPool;
+}
+
+void Renderer::Render(Scene* pScene)
 {
 	Camera& camera = pScene->GetCamera();
 	auto& materials = pScene->GetMaterials();
 	auto& lights = pScene->GetLights();
 
-	camera.CalculateCameraToWorld();
+#ifdef RAY_STATISTICS
+	// The pool workers register themselves, this thread traces tiles as well
+	Statistics::RegisterThread();
+#endif
 
-	// The number of pixels that are going to be shown
-	const unsigned int nrPixels{ static_cast<unsigned int>(m_Width * m_Height) };
+	// A heatmap measures the cost of a single frame, so it never accumulates
+	const bool costHeatmap{ IsHeatmapMode() };
+	const bool accumulate{ m_AccumulationEnabled && !costHeatmap };
+	if (!accumulate || pScene != m_pAccumulatedScene || camera.version != m_AccumulatedCameraVersion || pScene->GetVersion() != m_AccumulatedSceneVersion)
+	{
+		m_NrAccumulatedSamples = 0;
+		m_pAccumulatedScene = pScene;
+		m_AccumulatedCameraVersion = camera.version;
+		m_AccumulatedSceneVersion = pScene->GetVersion();
+	}
 
-#if defined(ASYNC)
-	// Async Logic
-	const unsigned int nrCores{ std::thread::hardware_concurrency() };
-	std::vector<std::future<void>> asyncFutures{};
+	if (IsConverged())
+	{
+		// Nothing changed since the last sample, the frame buffer still holds the final image
+		m_NrRaysLastFrame = 0;
+#ifdef RAY_STATISTICS
+		m_StatisticsLastFrame = {};
+#endif
+		// The summed samples are still valid, a changed display setting only needs them resolved again
+		if (m_ResolveSettingsChanged)
+		{
+			TRACE_ZONE("Resolve");
+			ResolveAccumulatedFrame(false);
+		}
+		TRACE_ZONE("Present");
+		m_pFrameBuffer->Present();
+		return;
+	}
 
-	const unsigned int nrPixelsPerTask{ nrPixels / nrCores };
-	unsigned int nrUnassignedPixels{ nrPixels % nrCores };
-	unsigned int curPixelIdx{};
+	// The first sample goes through the pixel centers, the next ones follow a Halton sequence so the edges converge anti-aliased
+	m_SampleOffsetX = m_NrAccumulatedSamples == 0 ? 0.5f : RadicalInverse(m_NrAccumulatedSamples, 2);
+	m_SampleOffsetY = m_NrAccumulatedSamples == 0 ? 0.5f : RadicalInverse(m_NrAccumulatedSamples, 3);
 
-	for (unsigned int coreIdx{}; coreIdx < nrCores; ++coreIdx)
+	camera.CalculateCameraToWorld();
 	{
-		unsigned int taskSize{ nrPixelsPerTask };
-		if (nrUnassignedPixels > 0)
+		TRACE_ZONE("UpdateAccelerationStructure");
+		pScene->UpdateAccelerationStructure();
+	}
+	// Building newly added shared meshes bumps their versions, the samples traced below already see them
+	m_AccumulatedSceneVersion = pScene->GetVersion();
+
+	// The screen is split up into 8x8 tiles, the pool hands them out and lets idle threads steal the expensive ones
+	// A heatmap needs the cost of every pixel on its own, so it traces single rays
+	const bool packetTracing{ m_PacketTracingEnabled && !costHeatmap };
+	const unsigned int nrTilesX{ (m_Width + g_PacketWidth - 1) / g_PacketWidth };
+	const unsigned int nrTilesY{ (m_Height + g_PacketWidth - 1) / g_PacketWidth };
+	const unsigned int nrTiles{ nrTilesX * nrTilesY };
+	// Summed once per tile, so the threads barely touch the shared counter
+	std::atomic<uint64_t> nrRays{};
+	const auto renderTask = [=, this, &nrRays](unsigned int tileIndex)
 		{
-			++taskSize;
-			--nrUnassignedPixels;
-		}
+			TRACE_ZONE_ARG("Tile", tileIndex);
+			if (packetTracing)
+			{
+				nrRays += RenderTile(pScene, tileIndex, camera, lights, materials);
+				return;
+			}
 
-		asyncFutures.push_back(
-			std::async(std::launch::async, [=, this]
+			const int firstX{ static_cast<int>(tileIndex % nrTilesX * g_PacketWidth) };
+			const int firstY{ static_cast<int>(tileIndex / nrTilesX * g_PacketWidth) };
+			const int endX{ std::min(firstX + static_cast<int>(g_PacketWidth), m_Width) };
+			const int endY{ std::min(firstY + static_cast<int>(g_PacketWidth), m_Height) };
+			uint32_t nrTileRays{};
+			for (int py{ firstY }; py < endY; ++py)
+			{
+				for (int px{ firstX }; px < endX; ++px)
 				{
-					const unsigned int endPixelIdx{ curPixelIdx + taskSize };
-					for (unsigned int pixelIdx{ curPixelIdx }; pixelIdx < endPixelIdx; ++pixelIdx)
-					{
-						RenderPixel(pScene, pixelIdx, camera, lights, materials);
-					}
-				})
-		);
+					const unsigned int pixelIndex{ static_cast<unsigned int>(py * m_Width + px) };
+					const uint64_t startCost{ costHeatmap ? ReadPixelCost() : 0 };
+					nrTileRays += RenderPixel(pScene, pixelIndex, camera, lights, materials);
+					if (costHeatmap) m_PixelCosts[pixelIndex] = static_cast<float>(ReadPixelCost() - startCost);
+				}
+			}
+			nrRays += nrTileRays;
+		};
 
-		curPixelIdx += taskSize;
+	{
+		TRACE_ZONE("RenderTiles");
+#if defined(THREAD_POOL)
+		m_pThreadPool->Dispatch(nrTiles, renderTask);
+#else
+		// Synchronous Logic
+		for (unsigned int i{}; i < nrTiles; ++i)
+		{
+			renderTask(i);
+		}
+#endif
 	}
-
-	for (const std::future<void>& f : asyncFutures)
+	m_NrRaysLastFrame = nrRays;
+	if (costHeatmap)
 	{
-		f.wait();
+		TRACE_ZONE("WriteHeatmap");
+		WriteHeatmap();
 	}
-
-#elif defined(PARALLEL_FOR)
-	// Parallel For Logic
-	concurrency::parallel_for(0u, nrPixels,
-		[=, this](int i)
-		{
-			RenderPixel(pScene, i, camera, lights, materials);
-		});
-#else
-	// Synchronous Logic
-	for (unsigned int i{}; i < nrPixels; ++i)
+	++m_NrAccumulatedSamples;
 	{
-		RenderPixel(pScene, i, camera, lights, materials);
+		TRACE_ZONE("Resolve");
+		ResolveAccumulatedFrame(costHeatmap);
 	}
+#ifdef RAY_STATISTICS
+	// Every tile is done, so no thread is still writing its counters
+	m_StatisticsLastFrame = Statistics::CollectCounters();
 #endif
 
 	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+	//Show the finished frame
+	TRACE_ZONE("Present");
+	m_pFrameBuffer->Present();
 }
 
-void dae::Renderer::RenderPixel(Scene* pScene, unsigned int pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material*>& materials) const
+uint32_t dae::Renderer::RenderPixel(Scene* pScene, unsigned int pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials)
 {
 	// Calculate the row and column from pixelIndex
 	const int px = pixelIndex % m_Width;
 	const int py = pixelIndex / m_Width;
 
+	// RAYCALCS ^
+	Ray viewRay(camera.origin, GetCameraRayDirection(px, py, camera));
+	STATS_INCREMENT(PrimaryRays);
+
+	// Hitrecord containing more information about a potential hit
+	HitRecord closestHit{};
+	// Get the closest object that interesected with the ray
+	pScene->GetClosestHit(viewRay, closestHit);
+
+	WritePixel(px, py, ShadeHit(pScene, closestHit, viewRay.direction, lights, materials));
+
+	// ShadeHit traces one shadow ray per light from every hit
+	return 1 + (closestHit.didHit && m_ShadowsEnabled ? static_cast<uint32_t>(lights.size()) : 0);
+}
+
+uint32_t dae::Renderer::RenderTile(Scene* pScene, unsigned int tileIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials)
+{
+	// Calculate the pixel bounds of the tile, the tiles on the right and bottom edge can be smaller
+	const int nrTilesX{ static_cast<int>((m_Width + g_PacketWidth - 1) / g_PacketWidth) };
+	const int startX{ static_cast<int>(tileIndex % nrTilesX) * static_cast<int>(g_PacketWidth) };
+	const int startY{ static_cast<int>(tileIndex / nrTilesX) * static_cast<int>(g_PacketWidth) };
+	const int endX{ std::min(startX + static_cast<int>(g_PacketWidth), m_Width) };
+	const int endY{ std::min(startY + static_cast<int>(g_PacketWidth), m_Height) };
+
+	RayPacket packet{};
+	for (int py{ startY }; py < endY; ++py)
+	{
+		for (int px{ startX }; px < endX; ++px)
+		{
+			packet.rays[packet.count++] = Ray(camera.origin, GetCameraRayDirection(px, py, camera));
+		}
+	}
+	packet.cornerDirections[0] = GetCameraRayDirection(startX, startY, camera);
+	packet.cornerDirections[1] = GetCameraRayDirection(endX - 1, startY, camera);
+	packet.cornerDirections[2] = GetCameraRayDirection(endX - 1, endY - 1, camera);
+	packet.cornerDirections[3] = GetCameraRayDirection(startX, endY - 1, camera);
+	packet.BuildFrustum();
+	STATS_ADD(PrimaryRays, packet.count);
+
+	HitRecord closestHits[g_PacketSize]{};
+	pScene->GetClosestHit(packet, closestHits);
+
+	// Shadow rays are gathered per light for the whole tile, so they all end in the same point and form a coherent packet
+	uint32_t nrRays{ packet.count };
+	ColorRGB finalColors[g_PacketSize]{};
+	Vector3 lightDirections[g_PacketSize];
+	Vector3 viewDirections[g_PacketSize];
+	for (uint32_t rayIndex{ 0 }; rayIndex < packet.count; ++rayIndex)
+	{
+		viewDirections[rayIndex] = packet.rays[rayIndex].direction;
+	}
+	uint32_t shadowRayPixels[g_PacketSize];
+	for (const Light& light : lights)
+	{
+		RayPacket shadowPacket{};
+		Vector3 shadowRayOrigins[g_PacketSize];
+		for (uint32_t rayIndex{ 0 }; rayIndex < packet.count; ++rayIndex)
+		{
+			const HitRecord& closestHit{ closestHits[rayIndex] };
+			if (!closestHit.didHit) continue;
+
+			// Get a ray from the point we hit, to the light and add a small offset
+			const Vector3 shadowRayOrigin{ closestHit.origin + (closestHit.normal * 0.001f) };
+			Vector3& lightDir{ lightDirections[rayIndex] };
+			lightDir = LightUtils::GetDirectionToLight(light, shadowRayOrigin);
+			const float lightrayMagnitude{ lightDir.Normalize() };
+
+			shadowRayPixels[shadowPacket.count] = rayIndex;
+			shadowRayOrigins[shadowPacket.count] = shadowRayOrigin;
+			shadowPacket.rays[shadowPacket.count++] = Ray{ shadowRayOrigin, lightDir, 0.0001f, lightrayMagnitude };
+		}
+		if (shadowPacket.count == 0) break;
+
+		bool occluded[g_PacketSize]{};
+		if (m_ShadowsEnabled)
+		{
+			shadowPacket.BuildFrustumAroundPoints(light.origin, shadowRayOrigins, shadowPacket.count);
+			pScene->DoesHit(shadowPacket, occluded);
+			nrRays += shadowPacket.count;
+		}
+
+		// Shade from the occlusion mask
+		uint32_t litRays[g_PacketSize];
+		uint32_t nrLitRays{};
+		for (uint32_t shadowRayIndex{ 0 }; shadowRayIndex < shadowPacket.count; ++shadowRayIndex)
+		{
+			if (!occluded[shadowRayIndex]) litRays[nrLitRays++] = shadowRayPixels[shadowRayIndex];
+		}
+		ShadeLight(closestHits, light, lightDirections, viewDirections, litRays, nrLitRays, materials, finalColors);
+	}
+
+	uint32_t rayIndex{};
+	for (int py{ startY }; py < endY; ++py)
+	{
+		for (int px{ startX }; px < endX; ++px, ++rayIndex)
+		{
+			WritePixel(px, py, finalColors[rayIndex]);
+		}
+	}
+	return nrRays;
+}
+
+Vector3 dae::Renderer::GetCameraRayDirection(int px, int py, const Camera& camera) const
+{
 	// Calculate the raster cordinates in camera space
-	const float cx{ ((2.0f * (px + 0.5f) / m_Width - 1.0f) * m_AspectRatio) * camera.fovMultiplier };
-	const float cy{ (1.0f - 2.0f * (py + 0.5f) / m_Height) * camera.fovMultiplier };
+	const float cx{ ((2.0f * (px + m_SampleOffsetX) / m_Width - 1.0f) * m_AspectRatio) * camera.fovMultiplier };
+	const float cy{ (1.0f - 2.0f * (py + m_SampleOffsetY) / m_Height) * camera.fovMultiplier };
 
 	// Calculate the direction from the camera to the raster
 	Vector3 rayDirection{ cx,cy,1 };
@@ -116,18 +298,14 @@ void dae::Renderer::RenderPixel(Scene* pScene, unsigned int pixelIndex, const Ca
 
 	rayDirection = camera.cameraToWorld.TransformVector(rayDirection);
 	rayDirection.Normalize();
+	return rayDirection;
+}
 
-	// RAYCALCS ^
-	Ray viewRay(camera.origin, rayDirection);
-
+ColorRGB dae::Renderer::ShadeHit(Scene* pScene, const HitRecord& closestHit, const Vector3& viewDirection, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+{
 	// Color to write to the color buffer (default is black)
 	ColorRGB finalColor{};
 
-	// Hitrecord containing more information about a potential hit
-	HitRecord closestHit{};
-	// Get the closest object that interesected with the ray
-	pScene->GetClosestHit(viewRay, closestHit);
-
 	// If we hit anything 
 	if (closestHit.didHit)
 	{
@@ -150,88 +328,218 @@ void dae::Renderer::RenderPixel(Scene* pScene, unsigned int pixelIndex, const Ca
 				}
 			}
 
-			float observedArea = Vector3::DotClamp(lightDir, closestHit.normal);
-			switch (m_CurrentLightingMode)
-			{
-			case LightingMode::ObservedArea:
-				if (observedArea > 0)
-				{
-					finalColor += ColorRGB{ 1,1,1 } * observedArea;
-				}
-				break;
-			case LightingMode::Radiance:
-				finalColor += LightUtils::GetRadiance(lights[i], closestHit.origin);
-				break;
-			case LightingMode::BRDF:
-				finalColor += materials[closestHit.materialIndex]->Shade(closestHit, lightDir, viewRay.direction);
-				break;
-			case LightingMode::Combined:
-				if (observedArea > 0)
-				{
-					finalColor += LightUtils::GetRadiance(lights[i], closestHit.origin) * observedArea * materials[closestHit.materialIndex]->Shade(closestHit, lightDir, viewRay.direction);
-				}
-				break;
-			}
+			const ColorRGB brdf{ NeedsBRDF() ? MaterialUtils::Shade(materials[closestHit.materialIndex], closestHit, lightDir, viewDirection) : ColorRGB{} };
+			finalColor += ShadeLight(closestHit, lights[i], lightDir, brdf);
+		}
+	}
+	return finalColor;
+}
+
+ColorRGB dae::Renderer::ShadeLight(const HitRecord& closestHit, const Light& light, const Vector3& lightDir, const ColorRGB& brdf) const
+{
+	float observedArea = Vector3::DotClamp(lightDir, closestHit.normal);
+	switch (m_CurrentLightingMode)
+	{
+	case LightingMode::ObservedArea:
+		if (observedArea > 0)
+		{
+			return ColorRGB{ 1,1,1 } * observedArea;
+		}
+		break;
+	case LightingMode::Radiance:
+		return LightUtils::GetRadiance(light, closestHit.origin);
+	case LightingMode::BRDF:
+		return brdf;
+	case LightingMode::Combined:
+		if (observedArea > 0)
+		{
+			return LightUtils::GetRadiance(light, closestHit.origin) * observedArea * brdf;
 		}
+		break;
+	case LightingMode::HeatmapCycles:
+	case LightingMode::HeatmapTests:
+	case LightingMode::Count:
+		// The heatmaps replace the shaded colors with the pixel costs
+		break;
 	}
+	return ColorRGB{};
+}
 
-	//Update Color in Buffer
-	finalColor.MaxToOne();
+void dae::Renderer::ShadeLight(const HitRecord* closestHits, const Light& light, const Vector3* lightDirections, const Vector3* viewDirections, uint32_t* rayIndices, uint32_t nrRays,
+	const std::vector<Material>& materials, ColorRGB* finalColors) const
+{
+	static_assert(g_PacketSize <= g_ShadingBatchSize);
+	if (!NeedsBRDF())
+	{
+		for (uint32_t i{ 0 }; i < nrRays; ++i)
+		{
+			const uint32_t rayIndex{ rayIndices[i] };
+			finalColors[rayIndex] += ShadeLight(closestHits[rayIndex], light, lightDirections[rayIndex], ColorRGB{});
+		}
+		return;
+	}
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+	// Points facing away from the light add nothing in the combined mode, so they are not worth a BRDF evaluation
+	if (m_CurrentLightingMode == LightingMode::Combined)
+	{
+		nrRays = static_cast<uint32_t>(std::remove_if(rayIndices, rayIndices + nrRays, [&](uint32_t rayIndex)
+			{
+				return !(Vector3::DotClamp(lightDirections[rayIndex], closestHits[rayIndex].normal) > 0);
+			}) - rayIndices);
+	}
+	std::sort(rayIndices, rayIndices + nrRays, [&](uint32_t a, uint32_t b) { return closestHits[a].materialIndex < closestHits[b].materialIndex; });
+
+	// Gather every run of one material into a batch and shade it in one go
+	ShadingBatch batch;
+	ColorRGB brdfs[g_PacketSize];
+	for (uint32_t batchStart{ 0 }; batchStart < nrRays;)
+	{
+		const unsigned char materialIndex{ closestHits[rayIndices[batchStart]].materialIndex };
+		batch.count = 0;
+		uint32_t batchEnd{ batchStart };
+		for (; batchEnd < nrRays && closestHits[rayIndices[batchEnd]].materialIndex == materialIndex; ++batchEnd)
+		{
+			const uint32_t rayIndex{ rayIndices[batchEnd] };
+			batch.Add(closestHits[rayIndex].normal, lightDirections[rayIndex], viewDirections[rayIndex]);
+		}
+
+		MaterialUtils::ShadeBatch(materials[materialIndex], batch, brdfs);
+		for (uint32_t i{ 0 }; i < batch.count; ++i)
+		{
+			const uint32_t rayIndex{ rayIndices[batchStart + i] };
+			finalColors[rayIndex] += ShadeLight(closestHits[rayIndex], light, lightDirections[rayIndex], brdfs[i]);
+		}
+		batchStart = batchEnd;
+	}
 }
 
-void dae::Renderer::Update(dae::Timer* pTimer)
+void dae::Renderer::ResolveAccumulatedFrame(bool costHeatmap)
 {
-	//Keyboard Input
-	const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
+	// The heatmap gradient is already in display range, exposure and tone mapping would only distort it
+	ResolveSettings resolveSettings{ costHeatmap ? ResolveSettings{} : m_ResolveSettings };
+	// Averages the summed samples
+	resolveSettings.exposure /= static_cast<float>(m_NrAccumulatedSamples);
+	ResolveFrame(resolveSettings);
+	m_ResolveSettingsChanged = false;
+}
+
+void dae::Renderer::ResolveFrame(const ResolveSettings& resolveSettings) const
+{
+	constexpr int nrRowsPerBand{ 16 };
+	const unsigned int nrBands{ static_cast<unsigned int>((m_Height + nrRowsPerBand - 1) / nrRowsPerBand) };
 
-	if (pKeyboardState[SDL_SCANCODE_F2])
+	const auto resolveTask = [&](unsigned int bandIndex)
+		{
+			const size_t firstPixel{ static_cast<size_t>(bandIndex) * nrRowsPerBand * m_Width };
+			const size_t nrPixels{ static_cast<size_t>(std::min(nrRowsPerBand, m_Height - static_cast<int>(bandIndex) * nrRowsPerBand)) * m_Width };
+			ToneMapping::Resolve(m_HDRPixels.data() + firstPixel, m_pBufferPixels + firstPixel, nrPixels, resolveSettings);
+		};
+
+#if defined(THREAD_POOL)
+	m_pThreadPool->Dispatch(nrBands, resolveTask);
+#else
+	for (unsigned int i{}; i < nrBands; ++i)
 	{
-		if (!m_F2Held) ToggleShadows();
-		m_F2Held = true;
+		resolveTask(i);
 	}
-	else m_F2Held = false;
-	if (pKeyboardState[SDL_SCANCODE_F3])
+#endif
+}
+
+uint64_t dae::Renderer::ReadPixelCost() const
+{
+	if (m_CurrentLightingMode == LightingMode::HeatmapTests)
 	{
-		if (!m_F3Held) CycleLightingMode();
-		m_F3Held = true;
+		const Statistics::Counters& counters{ Statistics::GetThreadCounters() };
+		return counters[Statistics::Counter::NodeVisits] + counters[Statistics::Counter::PrimitiveTests];
 	}
-	else m_F3Held = false;
-	if (pKeyboardState[SDL_SCANCODE_F6])
+	return Statistics::ReadCycleCounter();
+}
+
+void dae::Renderer::WriteHeatmap()
+{
+	std::vector<float> sortedCosts{ m_PixelCosts };
+	const auto percentile{ sortedCosts.begin() + static_cast<ptrdiff_t>(sortedCosts.size() * 0.99f) };
+	std::nth_element(sortedCosts.begin(), percentile, sortedCosts.end());
+	const float maxCost{ std::max(*percentile, 1.f) };
+
+	// Blue, cyan, green, yellow, red
+	const ColorRGB gradient[]{ { 0.f, 0.f, 0.5f }, { 0.f, 0.8f, 1.f }, { 0.f, 0.9f, 0.f }, { 1.f, 1.f, 0.f }, { 1.f, 0.f, 0.f } };
+	constexpr int nrSteps{ static_cast<int>(std::size(gradient)) - 1 };
+
+	for (int py{ 0 }; py < m_Height; ++py)
 	{
-		if (!m_F6Held) pTimer->StartBenchmark();
-		m_F6Held = true;
+		for (int px{ 0 }; px < m_Width; ++px)
+		{
+			const float cost{ std::min(m_PixelCosts[px + py * m_Width] / maxCost, 1.f) * nrSteps };
+			const int step{ std::min(static_cast<int>(cost), nrSteps - 1) };
+			WritePixel(px, py, ColorRGB::Lerp(gradient[step], gradient[step + 1], cost - step));
+		}
 	}
-	else m_F6Held = false;
 }
 
-bool Renderer::SaveBufferToImage() const
+bool Renderer::SaveBufferToImage(const std::string& filePath) const
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	return m_pFrameBuffer->SaveToBMP(filePath);
 }
 
 void dae::Renderer::CycleLightingMode()
 {
-	m_CurrentLightingMode = static_cast<LightingMode>((static_cast<int>(m_CurrentLightingMode) + 1) % 4);
-	std::cout << "Current Mode: ";
-	switch (m_CurrentLightingMode)
+	m_CurrentLightingMode = static_cast<LightingMode>((static_cast<int>(m_CurrentLightingMode) + 1) % static_cast<int>(LightingMode::Count));
+#ifndef RAY_STATISTICS
+	// Nothing counts the tests
+	if (m_CurrentLightingMode == LightingMode::HeatmapTests)
+	{
+		m_CurrentLightingMode = static_cast<LightingMode>((static_cast<int>(m_CurrentLightingMode) + 1) % static_cast<int>(LightingMode::Count));
+	}
+#endif
+	ResetAccumulation();
+	std::cout << "Current Mode: " << GetLightingModeName(m_CurrentLightingMode) << '\n';
+}
+
+const char* dae::Renderer::GetLightingModeName(LightingMode lightingMode)
+{
+	switch (lightingMode)
 	{
-	case LightingMode::BRDF:
-		std::cout << "BRDF";
-		break;
 	case LightingMode::ObservedArea:
-		std::cout << "ObservedArea";
-		break;
+		return "ObservedArea";
 	case LightingMode::Radiance:
-		std::cout << "Radiance";
-		break;
+		return "Radiance";
+	case LightingMode::BRDF:
+		return "BRDF";
 	case LightingMode::Combined:
-		std::cout << "Combined";
+		return "Combined";
+	case LightingMode::HeatmapCycles:
+		return "HeatmapCycles";
+	case LightingMode::HeatmapTests:
+		return "HeatmapTests";
+	case LightingMode::Count:
 		break;
 	}
-	std::cout << '\n';
+	return "Unknown";
+}
+
+void dae::Renderer::TogglePacketTracing()
+{
+	m_PacketTracingEnabled = !m_PacketTracingEnabled;
+	std::cout << "Packet Tracing: " << (m_PacketTracingEnabled ? "ON" : "OFF") << '\n';
+}
+
+void dae::Renderer::ToggleAccumulation()
+{
+	SetAccumulationEnabled(!m_AccumulationEnabled);
+	std::cout << "Progressive Accumulation: " << (m_AccumulationEnabled ? "ON" : "OFF") << '\n';
+}
+
+void dae::Renderer::CycleToneMapper()
+{
+	m_ResolveSettings.toneMapper = static_cast<ToneMapper>((static_cast<int>(m_ResolveSettings.toneMapper) + 1) % static_cast<int>(ToneMapper::Count));
+	m_ResolveSettingsChanged = true;
+	std::cout << "Tone Mapper: " << ToneMapping::GetToneMapperName(m_ResolveSettings.toneMapper) << '\n';
+}
+
+void dae::Renderer::ToggleSRGB()
+{
+	m_ResolveSettings.sRGB = !m_ResolveSettings.sRGB;
+	m_ResolveSettingsChanged = true;
+	std::cout << "sRGB Output: " << (m_ResolveSettings.sRGB ? "ON" : "OFF") << '\n';
 }
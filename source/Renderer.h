@@ -1,62 +1,139 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
-struct SDL_Window;
-struct SDL_Surface;
+#include "ColorRGB.h"
+#include "Material.h"
+#include "Statistics.h"
+#include "ToneMapping.h"
 
 namespace dae
 {
 	class Scene;
-	class Timer;
 	struct Camera;
 	struct Light;
-	class Material;
+	struct HitRecord;
+	struct Vector3;
+	class ThreadPool;
+	class FrameBuffer;
 
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
-		~Renderer() = default;
+		// The frame buffer is not owned, its size is the render resolution
+		Renderer(FrameBuffer* pFrameBuffer);
+		~Renderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer(Renderer&&) noexcept = delete;
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
-		void RenderPixel(Scene* pScene, unsigned int pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material*>& materials) const;
-		void Update(dae::Timer* pTimer);
-		bool SaveBufferToImage() const;
-
-		void CycleLightingMode();
-		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; }
-
-	private:
+		void Render(Scene* pScene);
+		// Both return the number of rays they traced
+		uint32_t RenderPixel(Scene* pScene, unsigned int pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials);
+		// Traces the camera rays of an 8x8 tile as one packet, then the shadow rays of the tile as one packet per light
+		uint32_t RenderTile(Scene* pScene, unsigned int tileIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials);
+		// Returns false when the image could not be written
+		bool SaveBufferToImage(const std::string& filePath = "RayTracing_Buffer.bmp") const;
 
 		enum class LightingMode
 		{
-			ObservedArea, // Lambert Cosine
-			Radiance,	  // Incident Radiance
-			BRDF,		  // Scattering of the light
-			Combined	  // ObservedArea * Radiance * BRDF
+			ObservedArea,  // Lambert Cosine
+			Radiance,	   // Incident Radiance
+			BRDF,		   // Scattering of the light
+			Combined,	   // ObservedArea * Radiance * BRDF
+			HeatmapCycles, // CPU cycles spent on every pixel
+			HeatmapTests,  // BVH node visits + primitive tests of every pixel, needs RAY_STATISTICS
+
+			Count
 		};
 
+		void CycleLightingMode();
+		void SetLightingMode(LightingMode lightingMode) { m_CurrentLightingMode = lightingMode; ResetAccumulation(); }
+		static const char* GetLightingModeName(LightingMode lightingMode);
+		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; ResetAccumulation(); }
+		void TogglePacketTracing();
+
+		// While the camera and scene versions stay the same, every Render adds one jittered sample per pixel instead of tracing the same frame again
+		void SetAccumulationEnabled(bool isEnabled) { m_AccumulationEnabled = isEnabled; ResetAccumulation(); }
+		void ToggleAccumulation();
+		// Starts over from a single sample on the next Render, for changes the version counters do not cover
+		void ResetAccumulation() { m_NrAccumulatedSamples = 0; }
+		uint32_t GetNrAccumulatedSamples() const { return m_NrAccumulatedSamples; }
+		// All samples are in, Render only presents the finished image until something changes
+		bool IsConverged() const { return m_NrAccumulatedSamples >= m_MaxAccumulatedSamples; }
+
+		// Display only, a converged image is resolved again from its samples instead of traced again
+		void SetResolveSettings(const ResolveSettings& resolveSettings) { m_ResolveSettings = resolveSettings; m_ResolveSettingsChanged = true; }
+		const ResolveSettings& GetResolveSettings() const { return m_ResolveSettings; }
+		void CycleToneMapper();
+		void ToggleSRGB();
+
+		// Camera and shadow rays traced during the last Render
+		uint64_t GetNrRaysLastFrame() const { return m_NrRaysLastFrame; }
+		// Merged thread counters of the last Render, all zero unless RAY_STATISTICS is defined
+		const Statistics::Counters& GetStatisticsLastFrame() const { return m_StatisticsLastFrame; }
+
+	private:
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
 		bool m_ShadowsEnabled{ true };
+		bool m_PacketTracingEnabled{ true };
+		bool m_AccumulationEnabled{ true };
+		uint32_t m_MaxAccumulatedSamples{ 256 };
 
-		bool m_F2Held{ false };
-		bool m_F3Held{ false };
-		bool m_F6Held{ false };
-
-		SDL_Window* m_pWindow{};
+		ThreadPool* m_pThreadPool{};
 
-		SDL_Surface* m_pBuffer{};
+		FrameBuffer* m_pFrameBuffer{};
 		uint32_t* m_pBufferPixels{};
+		// Linear radiance of every pixel summed over the accumulated samples, tone mapped into the frame buffer once the frame is traced
+		std::vector<ColorRGB> m_HDRPixels{};
+		uint32_t m_NrAccumulatedSamples{};
+		// What the accumulated samples were traced of
+		const Scene* m_pAccumulatedScene{};
+		uint32_t m_AccumulatedCameraVersion{};
+		uint32_t m_AccumulatedSceneVersion{};
+		// Position of the camera rays inside their pixels for the current sample, the center for the first one
+		float m_SampleOffsetX{ 0.5f };
+		float m_SampleOffsetY{ 0.5f };
+		ResolveSettings m_ResolveSettings{};
+		// The frame buffer was resolved with older settings than m_ResolveSettings
+		bool m_ResolveSettingsChanged{};
 
 		int m_Width{};
 		int m_Height{};
 		float m_AspectRatio{};
+
+		uint64_t m_NrRaysLastFrame{};
+		Statistics::Counters m_StatisticsLastFrame{};
+		// Cost of every pixel, only filled in by the heatmap modes
+		std::vector<float> m_PixelCosts{};
+
+		Vector3 GetCameraRayDirection(int px, int py, const Camera& camera) const;
+		ColorRGB ShadeHit(Scene* pScene, const HitRecord& closestHit, const Vector3& viewDirection, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		// Contribution of one unoccluded light, brdf is only read by the lighting modes that need it
+		ColorRGB ShadeLight(const HitRecord& closestHit, const Light& light, const Vector3& lightDir, const ColorRGB& brdf) const;
+		// Adds the contribution of one light to the given lit rays of a tile, sorted by material so every material shades its rays as one batch
+		void ShadeLight(const HitRecord* closestHits, const Light& light, const Vector3* lightDirections, const Vector3* viewDirections, uint32_t* rayIndices, uint32_t nrRays,
+			const std::vector<Material>& materials, ColorRGB* finalColors) const;
+		bool NeedsBRDF() const { return m_CurrentLightingMode == LightingMode::BRDF || m_CurrentLightingMode == LightingMode::Combined; }
+		void WritePixel(int px, int py, const ColorRGB& finalColor)
+		{
+			ColorRGB& pixel{ m_HDRPixels[px + (py * m_Width)] };
+			if (m_NrAccumulatedSamples == 0) pixel = finalColor;
+			else pixel += finalColor;
+		}
+		// Tone maps and packs the HDR pixels into the frame buffer, in bands of rows spread over the pool
+		void ResolveFrame(const ResolveSettings& resolveSettings) const;
+		// Resolves the average of the accumulated samples with the current settings
+		void ResolveAccumulatedFrame(bool costHeatmap);
+
+		bool IsHeatmapMode() const { return m_CurrentLightingMode == LightingMode::HeatmapCycles || m_CurrentLightingMode == LightingMode::HeatmapTests; }
+		// Running cost counter of the calling thread for the current heatmap mode
+		uint64_t ReadPixelCost() const;
+		// Maps the pixel costs from cheap (blue) to expensive (red), scaled to the 99th percentile so a few outliers do not wash out the rest
+		void WriteHeatmap();
 	};
 }
@@ -0,0 +1,39 @@
+#include "SDLFrameBuffer.h"
+
+#include "SDL.h"
+#include "SDL_surface.h"
+
+namespace dae
+{
+	SDLFrameBuffer::SDLFrameBuffer(SDL_Window* pWindow) :
+		FrameBuffer(0, 0),
+		m_pWindow{ pWindow },
+		m_pWindowSurface{ SDL_GetWindowSurface(pWindow) }
+	{
+		SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+		if (!m_pWindowSurface) return;
+
+		// Render straight into the window when its layout matches, through a back buffer otherwise
+		const uint32_t windowFormat{ m_pWindowSurface->format->format };
+		if (windowFormat == SDL_PIXELFORMAT_RGB888 && m_pWindowSurface->pitch == m_Width * 4)
+		{
+			m_pPixels = static_cast<uint32_t*>(m_pWindowSurface->pixels);
+		}
+		else
+		{
+			m_pBackBuffer = SDL_CreateRGBSurfaceWithFormat(0, m_Width, m_Height, 32, SDL_PIXELFORMAT_RGB888);
+			if (m_pBackBuffer) m_pPixels = static_cast<uint32_t*>(m_pBackBuffer->pixels);
+		}
+	}
+
+	SDLFrameBuffer::~SDLFrameBuffer()
+	{
+		if (m_pBackBuffer) SDL_FreeSurface(m_pBackBuffer);
+	}
+
+	void SDLFrameBuffer::Present()
+	{
+		if (m_pBackBuffer) SDL_BlitSurface(m_pBackBuffer, nullptr, m_pWindowSurface, nullptr);
+		SDL_UpdateWindowSurface(m_pWindow);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+#include "FrameBuffer.h"
+
+struct SDL_Window;
+struct SDL_Surface;
+
+namespace dae
+{
+	// Surface of an SDL window, shown on Present
+	class SDLFrameBuffer final : public FrameBuffer
+	{
+	public:
+		explicit SDLFrameBuffer(SDL_Window* pWindow);
+		~SDLFrameBuffer() override;
+
+		SDLFrameBuffer(const SDLFrameBuffer&) = delete;
+		SDLFrameBuffer(SDLFrameBuffer&&) noexcept = delete;
+		SDLFrameBuffer& operator=(const SDLFrameBuffer&) = delete;
+		SDLFrameBuffer& operator=(SDLFrameBuffer&&) noexcept = delete;
+
+		// False when SDL could not create the surfaces, the frame buffer has no pixels then
+		bool IsValid() const { return m_pPixels != nullptr; }
+
+		void Present() override;
+
+	private:
+		SDL_Window* m_pWindow{};
+		SDL_Surface* m_pWindowSurface{};
+		// Only used when the window surface has a different pixel layout, blitted to the window on Present
+		SDL_Surface* m_pBackBuffer{};
+	};
+}
\ No newline at end of file
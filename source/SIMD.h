@@ -0,0 +1,69 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC emits AVX2 intrinsics anywhere, GCC/Clang need the target enabled per function
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+namespace dae
+{
+	enum class SIMDLevel
+	{
+		Scalar,
+		SSE,  // 4-wide
+		AVX2  // 8-wide
+	};
+
+	namespace SIMD
+	{
+		inline SIMDLevel DetectSIMDLevel()
+		{
+#if defined(SIMD_X86)
+#if defined(_MSC_VER)
+			int cpuInfo[4]{};
+			__cpuid(cpuInfo, 0);
+			const int nrIds{ cpuInfo[0] };
+
+			__cpuid(cpuInfo, 1);
+			const bool hasOSXSAVE{ (cpuInfo[2] & (1 << 27)) != 0 };
+			const bool hasAVX{ (cpuInfo[2] & (1 << 28)) != 0 };
+
+			bool hasAVX2{ false };
+			if (nrIds >= 7)
+			{
+				__cpuidex(cpuInfo, 7, 0);
+				hasAVX2 = (cpuInfo[1] & (1 << 5)) != 0;
+			}
+
+			// The OS also has to save the YMM registers on context switches
+			const bool osSupportsYMM{ hasOSXSAVE && hasAVX && (_xgetbv(0) & 0x6) == 0x6 };
+			if (hasAVX2 && osSupportsYMM) return SIMDLevel::AVX2;
+			return SIMDLevel::SSE;
+#else
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2")) return SIMDLevel::AVX2;
+			return SIMDLevel::SSE;
+#endif
+#else
+			return SIMDLevel::Scalar;
+#endif
+		}
+
+		// Detected once, the result never changes while running
+		inline SIMDLevel GetSIMDLevel()
+		{
+			static const SIMDLevel level{ DetectSIMDLevel() };
+			return level;
+		}
+	}
+}
\ No newline at end of file
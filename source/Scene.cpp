@@ -1,13 +1,17 @@
 #include "Scene.h"
 #include "Utils.h"
+#include "MeshCache.h"
 #include "Material.h"
+#include "Statistics.h"
+
+#include <algorithm>
 
 namespace dae {
 
 #pragma region Base Scene
 	//Initialize Scene with Default Solid Color Material (RED)
 	Scene::Scene():
-		m_Materials({ new Material_SolidColor({1,0,0})})
+		m_Materials({ Material_SolidColor({1,0,0}) })
 	{
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
@@ -15,75 +19,370 @@ namespace dae {
 		m_Lights.reserve(32);
 	}
 
-	Scene::~Scene()
-	{
-		for(auto& pMaterial : m_Materials)
-		{
-			delete pMaterial;
-			pMaterial = nullptr;
-		}
-
-		m_Materials.clear();
-	}
+	Scene::~Scene() = default;
 
 	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
 	{
+		STATS_INCREMENT(ClosestHitRays);
+
 		HitRecord hitRecord{};
 		HitRecord smallestTrecord{};
 		smallestTrecord.t = ray.max;
-		for (const Sphere& sphere : m_SphereGeometries)
+
+		// Planes first, they usually enclose the scene and shrink the ray before the BVH walk
+		Ray closestRay{ ray };
+		for (const Plane& plane : m_PlaneGeometries)
 		{
-			GeometryUtils::HitTest_Sphere(sphere, ray,hitRecord);
+			GeometryUtils::HitTest_Plane(plane, closestRay, hitRecord);
 			if (hitRecord.t < smallestTrecord.t)
 			{
 				smallestTrecord = hitRecord;
+				closestRay.max = hitRecord.t;
 			}
 		}
-		for (const Plane& plane : m_PlaneGeometries)
+
+		if (!m_TopLevelBVH.IsEmpty())
 		{
-			GeometryUtils::HitTest_Plane(plane, ray, hitRecord);
-			if (hitRecord.t < smallestTrecord.t)
+			const BVHNode& root{ m_TopLevelBVH.nodes[0] };
+			float tEntry{};
+			if (GeometryUtils::SlabTest_AABB(root.minAABB, root.maxAABB, closestRay, tEntry))
 			{
-				smallestTrecord = hitRecord;
+				GeometryUtils::TraverseBVH(m_TopLevelBVH, m_TopLevelWideBVH, closestRay, [&](uint32_t objectIndex, Ray& currentRay)
+					{
+						const ObjectReference& object{ m_BoundedObjects[objectIndex] };
+						switch (object.type)
+						{
+						case ObjectType::Sphere:
+							GeometryUtils::HitTest_Sphere(m_SphereGeometries[object.index], currentRay, hitRecord);
+							break;
+						case ObjectType::TriangleMesh:
+							GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[object.index], currentRay, hitRecord);
+							break;
+						case ObjectType::MeshInstance:
+						{
+							const MeshInstance& instance{ m_MeshInstances[object.index] };
+							GeometryUtils::HitTest_MeshInstance(instance, m_Meshes[instance.mesh], currentRay, hitRecord);
+							break;
+						}
+						}
+						if (hitRecord.didHit && hitRecord.t < smallestTrecord.t)
+						{
+							smallestTrecord = hitRecord;
+							currentRay.max = hitRecord.t;
+						}
+						return false;
+					});
 			}
 		}
-		for (const TriangleMesh& triangleMesh : m_TriangleMeshGeometries)
+
+		STATS_ADD(Hits, smallestTrecord.didHit);
+		closestHit = smallestTrecord;
+		return;
+	}
+
+	void Scene::GetClosestHit(const RayPacket& packet, HitRecord* closestHits) const
+	{
+		// Rays spread too far apart to share a frustum gain nothing from tracing them together
+		if (!packet.frustum.isValid)
 		{
-			GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray, hitRecord);
-			if (hitRecord.t < smallestTrecord.t)
+			for (uint32_t r{ 0 }; r < packet.count; ++r)
 			{
-				smallestTrecord = hitRecord;
+				GetClosestHit(packet.rays[r], closestHits[r]);
 			}
+			return;
 		}
 
-		closestHit = smallestTrecord;
-		return;
+		STATS_ADD(ClosestHitRays, packet.count);
+
+		RayPacket closestPacket{ packet };
+		HitRecord hitRecord{};
+		for (uint32_t r{ 0 }; r < closestPacket.count; ++r)
+		{
+			Ray& closestRay{ closestPacket.rays[r] };
+			HitRecord& smallestTrecord{ closestHits[r] };
+			smallestTrecord = HitRecord{};
+			smallestTrecord.t = closestRay.max;
+
+			for (const Plane& plane : m_PlaneGeometries)
+			{
+				if (GeometryUtils::HitTest_Plane(plane, closestRay, hitRecord) && hitRecord.t < smallestTrecord.t)
+				{
+					smallestTrecord = hitRecord;
+					closestRay.max = hitRecord.t;
+				}
+			}
+		}
+
+		if (m_TopLevelBVH.IsEmpty())
+		{
+			STATS_ADD(Hits, std::count_if(closestHits, closestHits + packet.count, [](const HitRecord& hit) { return hit.didHit; }));
+			return;
+		}
+
+		GeometryUtils::TraversePacketBVHLeaves(m_TopLevelBVH, closestPacket, 0, [&](uint32_t nodeIndex, RayPacket& currentPacket, uint32_t firstActive)
+			{
+				const BVHNode& leaf{ m_TopLevelBVH.nodes[nodeIndex] };
+				for (uint32_t i{ 0 }; i < leaf.primitiveCount; ++i)
+				{
+					const ObjectReference& object{ m_BoundedObjects[m_TopLevelBVH.primitiveIndices[leaf.leftFirst + i]] };
+					switch (object.type)
+					{
+					case ObjectType::Sphere:
+						for (uint32_t r{ firstActive }; r < currentPacket.count; ++r)
+						{
+							Ray& currentRay{ currentPacket.rays[r] };
+							if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[object.index], currentRay, hitRecord) && hitRecord.t < closestHits[r].t)
+							{
+								closestHits[r] = hitRecord;
+								currentRay.max = hitRecord.t;
+							}
+						}
+						break;
+					case ObjectType::TriangleMesh:
+						GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[object.index], currentPacket, firstActive, closestHits);
+						break;
+					case ObjectType::MeshInstance:
+					{
+						const MeshInstance& instance{ m_MeshInstances[object.index] };
+						GeometryUtils::HitTest_MeshInstance(instance, m_Meshes[instance.mesh], currentPacket, firstActive, closestHits);
+						break;
+					}
+					}
+				}
+				return false;
+			});
+		STATS_ADD(Hits, std::count_if(closestHits, closestHits + packet.count, [](const HitRecord& hit) { return hit.didHit; }));
 	}
 
-	bool Scene::DoesHit(const Ray& ray) const
+	void Scene::DoesHit(const RayPacket& packet, bool* occluded) const
 	{
-		for (const Sphere& sphere : m_SphereGeometries)
+		if (!packet.frustum.isValid)
 		{
-			if (GeometryUtils::HitTest_Sphere(sphere, ray))
+			for (uint32_t r{ 0 }; r < packet.count; ++r)
 			{
-				return true;
+				occluded[r] = DoesHit(packet.rays[r]);
 			}
+			return;
+		}
+
+		STATS_ADD(ShadowRays, packet.count);
+
+		RayPacket shadowPacket{ packet };
+		uint32_t nrOccluded{};
+		for (uint32_t r{ 0 }; r < shadowPacket.count; ++r)
+		{
+			occluded[r] = false;
+			for (const Plane& plane : m_PlaneGeometries)
+			{
+				if (GeometryUtils::DoesHit_Plane(plane, shadowPacket.rays[r]))
+				{
+					occluded[r] = true;
+					GeometryUtils::RetireRay(shadowPacket.rays[r]);
+					++nrOccluded;
+					break;
+				}
+			}
+		}
+
+		if (m_TopLevelBVH.IsEmpty() || nrOccluded == shadowPacket.count)
+		{
+			STATS_ADD(Hits, nrOccluded);
+			return;
 		}
+
+		GeometryUtils::TraversePacketBVHLeaves(m_TopLevelBVH, shadowPacket, 0, [&](uint32_t nodeIndex, RayPacket& currentPacket, uint32_t firstActive)
+			{
+				const BVHNode& leaf{ m_TopLevelBVH.nodes[nodeIndex] };
+				for (uint32_t i{ 0 }; i < leaf.primitiveCount; ++i)
+				{
+					const ObjectReference& object{ m_BoundedObjects[m_TopLevelBVH.primitiveIndices[leaf.leftFirst + i]] };
+					switch (object.type)
+					{
+					case ObjectType::Sphere:
+						for (uint32_t r{ firstActive }; r < currentPacket.count; ++r)
+						{
+							if (!occluded[r] && GeometryUtils::DoesHit_Sphere(m_SphereGeometries[object.index], currentPacket.rays[r]))
+							{
+								occluded[r] = true;
+								GeometryUtils::RetireRay(currentPacket.rays[r]);
+							}
+						}
+						break;
+					case ObjectType::TriangleMesh:
+						GeometryUtils::DoesHit_TriangleMesh(m_TriangleMeshGeometries[object.index], currentPacket, firstActive, occluded);
+						break;
+					case ObjectType::MeshInstance:
+					{
+						const MeshInstance& instance{ m_MeshInstances[object.index] };
+						GeometryUtils::DoesHit_MeshInstance(instance, m_Meshes[instance.mesh], currentPacket, firstActive, occluded);
+						break;
+					}
+					}
+				}
+
+				// Every ray is blocked, the rest of the scene cannot change the mask anymore
+				for (uint32_t r{ 0 }; r < currentPacket.count; ++r)
+				{
+					if (!occluded[r]) return false;
+				}
+				return true;
+			});
+		STATS_ADD(Hits, std::count(occluded, occluded + packet.count, true));
+	}
+
+	bool Scene::DoesHit(const Ray& ray) const
+	{
+		STATS_INCREMENT(ShadowRays);
+
 		for (const Plane& plane: m_PlaneGeometries)
 		{
-			if (GeometryUtils::HitTest_Plane(plane, ray))
+			if (GeometryUtils::DoesHit_Plane(plane, ray))
 			{
+				STATS_INCREMENT(Hits);
 				return true;
 			}
 		}
-		for (const TriangleMesh& triangleMesh : m_TriangleMeshGeometries)
+
+		if (m_TopLevelBVH.IsEmpty()) return false;
+
+		const BVHNode& root{ m_TopLevelBVH.nodes[0] };
+		float tEntry{};
+		if (!GeometryUtils::SlabTest_AABB(root.minAABB, root.maxAABB, ray, tEntry))
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray))
+			return false;
+		}
+
+		Ray shadowRay{ ray };
+		const bool isOccluded{ GeometryUtils::TraverseBVH(m_TopLevelBVH, m_TopLevelWideBVH, shadowRay, [&](uint32_t objectIndex, Ray& currentRay)
 			{
-				return true;
+				const ObjectReference& object{ m_BoundedObjects[objectIndex] };
+				switch (object.type)
+				{
+				case ObjectType::Sphere:
+					return GeometryUtils::DoesHit_Sphere(m_SphereGeometries[object.index], currentRay);
+				case ObjectType::TriangleMesh:
+					return GeometryUtils::DoesHit_TriangleMesh(m_TriangleMeshGeometries[object.index], currentRay);
+				case ObjectType::MeshInstance:
+				{
+					const MeshInstance& instance{ m_MeshInstances[object.index] };
+					return GeometryUtils::DoesHit_MeshInstance(instance, m_Meshes[instance.mesh], currentRay);
+				}
+				}
+				return false;
+			}) };
+		STATS_ADD(Hits, isOccluded);
+		return isOccluded;
+	}
+
+	uint32_t Scene::GetVersion() const
+	{
+		// Every counter only grows, so the sum changes as soon as one of them does
+		uint32_t version{ m_Version };
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+		{
+			version += mesh.version;
+		}
+		for (const TriangleMesh& mesh : m_Meshes)
+		{
+			version += mesh.version;
+		}
+		for (const MeshInstance& instance : m_MeshInstances)
+		{
+			version += instance.version;
+		}
+		return version;
+	}
+
+	void Scene::UpdateAccelerationStructure()
+	{
+		const size_t nrObjects{ m_SphereGeometries.size() + m_TriangleMeshGeometries.size() + m_MeshInstances.size() };
+		const bool objectsChanged{ nrObjects != m_BoundedObjects.size() };
+		if (objectsChanged)
+		{
+			// Builds the BVH of shared meshes that were filled since the last update
+			for (TriangleMesh& mesh : m_Meshes)
+			{
+				mesh.UpdateTransforms();
+			}
+
+			m_BoundedObjects.clear();
+			m_BoundedObjects.reserve(nrObjects);
+			for (uint32_t i{ 0 }; i < m_SphereGeometries.size(); ++i)
+			{
+				m_BoundedObjects.push_back({ ObjectType::Sphere, i });
+			}
+			for (uint32_t i{ 0 }; i < m_TriangleMeshGeometries.size(); ++i)
+			{
+				m_BoundedObjects.push_back({ ObjectType::TriangleMesh, i });
+			}
+			for (uint32_t i{ 0 }; i < m_MeshInstances.size(); ++i)
+			{
+				m_BoundedObjects.push_back({ ObjectType::MeshInstance, i });
+			}
+		}
+
+		for (MeshInstance& instance : m_MeshInstances)
+		{
+			instance.UpdateTransformedAABB(m_Meshes[instance.mesh]);
+		}
+
+		std::vector<Vector3> minBounds{};
+		std::vector<Vector3> maxBounds{};
+		GetObjectBounds(minBounds, maxBounds);
+
+		// Same objects, only moved: keep the topology and just refit the bounds, unless the tree degraded too much
+		if (!objectsChanged && !m_TopLevelBVH.IsEmpty())
+		{
+			m_TopLevelBVH.Refit(minBounds, maxBounds);
+			if (!m_TopLevelBVH.NeedsRebuild(m_TopLevelRebuildThreshold))
+			{
+				m_TopLevelWideBVH.Refit(m_TopLevelBVH);
+				return;
+			}
+		}
+
+		std::vector<Vector3> centroids(nrObjects);
+		for (size_t i{ 0 }; i < nrObjects; ++i)
+		{
+			centroids[i] = (minBounds[i] + maxBounds[i]) / 2.f;
+		}
+		m_TopLevelBVH.Build(minBounds, maxBounds, centroids);
+		m_TopLevelWideBVH.Build(m_TopLevelBVH);
+	}
+
+	void Scene::GetObjectBounds(std::vector<Vector3>& minBounds, std::vector<Vector3>& maxBounds) const
+	{
+		minBounds.resize(m_BoundedObjects.size());
+		maxBounds.resize(m_BoundedObjects.size());
+		for (size_t i{ 0 }; i < m_BoundedObjects.size(); ++i)
+		{
+			const ObjectReference& object{ m_BoundedObjects[i] };
+			switch (object.type)
+			{
+			case ObjectType::Sphere:
+			{
+				const Sphere& sphere{ m_SphereGeometries[object.index] };
+				const Vector3 radius{ sphere.radius, sphere.radius, sphere.radius };
+				minBounds[i] = sphere.origin - radius;
+				maxBounds[i] = sphere.origin + radius;
+				break;
+			}
+			case ObjectType::TriangleMesh:
+			{
+				const TriangleMesh& mesh{ m_TriangleMeshGeometries[object.index] };
+				minBounds[i] = mesh.transformedMinAABB;
+				maxBounds[i] = mesh.transformedMaxAABB;
+				break;
+			}
+			case ObjectType::MeshInstance:
+			{
+				const MeshInstance& instance{ m_MeshInstances[object.index] };
+				minBounds[i] = instance.transformedMinAABB;
+				maxBounds[i] = instance.transformedMaxAABB;
+				break;
+			}
 			}
 		}
-		return false;
 	}
 
 #pragma region Scene Helpers
@@ -95,6 +394,7 @@ namespace dae {
 		s.materialIndex = materialIndex;
 
 		m_SphereGeometries.emplace_back(s);
+		++m_Version;
 		return &m_SphereGeometries.back();
 	}
 
@@ -106,6 +406,7 @@ namespace dae {
 		p.materialIndex = materialIndex;
 
 		m_PlaneGeometries.emplace_back(p);
+		++m_Version;
 		return &m_PlaneGeometries.back();
 	}
 
@@ -116,9 +417,31 @@ namespace dae {
 		m.materialIndex = materialIndex;
 
 		m_TriangleMeshGeometries.emplace_back(m);
+		++m_Version;
 		return &m_TriangleMeshGeometries.back();
 	}
 
+	MeshHandle Scene::AddMesh(TriangleCullMode cullMode)
+	{
+		TriangleMesh m{};
+		m.cullMode = cullMode;
+
+		m_Meshes.emplace_back(m);
+		++m_Version;
+		return static_cast<MeshHandle>(m_Meshes.size() - 1);
+	}
+
+	MeshInstance* Scene::AddMeshInstance(MeshHandle meshHandle, const Matrix& transform, unsigned char materialIndex)
+	{
+		MeshInstance i{};
+		i.mesh = meshHandle;
+		i.materialIndex = materialIndex;
+		i.SetTransform(transform);
+
+		m_MeshInstances.emplace_back(i);
+		return &m_MeshInstances.back();
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -143,9 +466,9 @@ namespace dae {
 		return &m_Lights.back();
 	}
 
-	unsigned char Scene::AddMaterial(Material* pMaterial)
+	unsigned char Scene::AddMaterial(const Material& material)
 	{
-		m_Materials.push_back(pMaterial);
+		m_Materials.push_back(material);
 		return static_cast<unsigned char>(m_Materials.size() - 1);
 	}
 #pragma endregion
@@ -156,11 +479,11 @@ namespace dae {
 	{
 				//default: Material id0 >> SolidColor Material (RED)
 		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
+		const unsigned char matId_Solid_Blue = AddMaterial(Material_SolidColor{ colors::Blue });
 
-		const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
+		const unsigned char matId_Solid_Yellow = AddMaterial(Material_SolidColor{ colors::Yellow });
+		const unsigned char matId_Solid_Green = AddMaterial(Material_SolidColor{ colors::Green });
+		const unsigned char matId_Solid_Magenta = AddMaterial(Material_SolidColor{ colors::Magenta });
 
 		//Spheres
 		AddSphere({ -25.f, 0.f, 100.f }, 50.f, matId_Solid_Red);
@@ -181,11 +504,11 @@ namespace dae {
 
 		//default: Material id0 >> SolidColor Material (RED)
 		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
+		const unsigned char matId_Solid_Blue = AddMaterial(Material_SolidColor{ colors::Blue });
 
-		const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
+		const unsigned char matId_Solid_Yellow = AddMaterial(Material_SolidColor{ colors::Yellow });
+		const unsigned char matId_Solid_Green = AddMaterial(Material_SolidColor{ colors::Green });
+		const unsigned char matId_Solid_Magenta = AddMaterial(Material_SolidColor{ colors::Magenta });
 
 		//Plane
 		AddPlane({ -5.f,0.f,0.f }, { 1.f,0.f,0.f }, matId_Solid_Green);
@@ -210,14 +533,14 @@ namespace dae {
 	{
 		m_Camera = Camera{ { 0.f, 3.f, -9.f }, 45.f };
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972, .960f, .915f }, 1.f, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(Material_CookTorrence({ .972, .960f, .915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(Material_CookTorrence({ .972, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(Material_CookTorrence({ .972, .960f, .915f }, 1.f, .1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(Material_CookTorrence({ .75f, .75f, .75f }, 0.f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ .49f, .57f, .57f }, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue);; //Back
@@ -246,8 +569,8 @@ namespace dae {
 		m_Camera.SetFovAngle(45.f);
 
 		// Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f,0.57f,0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White,1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ .49f,0.57f,0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material_Lambert(colors::White,1.f));
 
 		// Planes
 		AddPlane(Vector3{ 0.f,0.f,10.f }, Vector3{ 0.f,0.f,-1.f }, matLambert_GrayBlue);
@@ -290,8 +613,8 @@ namespace dae {
 		m_Camera.SetFovAngle(45.f);
 
 		// Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f,0.57f,0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ .49f,0.57f,0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material_Lambert(colors::White, 1.f));
 
 		// Planes
 		AddPlane(Vector3{ 0.f,0.f,10.f }, Vector3{ 0.f,0.f,-1.f }, matLambert_GrayBlue);
@@ -302,7 +625,7 @@ namespace dae {
 
 		// Triangle mesh
 		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/simple_cube.obj", pMesh->positions, pMesh->normals, pMesh->indices);
+		MeshCache::LoadOBJ("Resources/simple_cube.obj", *pMesh);
 		//pMesh->positions = {
 		//	{-.75f,-1.f,.0f}, // V0
 		//	{-.75f,1.f,.0f},  // V2
@@ -340,15 +663,15 @@ namespace dae {
 		m_Camera.origin = { 0.f, 3.0f, -9.0f };
 		m_Camera.SetFovAngle(45.f);
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.0f, 1.0f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.0f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.0f, 0.6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.0f, 1.0f));
+		const auto matCT_GrayMediumMetal = AddMaterial(Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.0f, 0.6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.0f, 0.1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.0f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.0f, 0.6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.0f, 0.1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.0f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.0f));
+		const auto matLambert_White = AddMaterial(Material_Lambert(colors::White, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.0f, 0.0f, 10.0f }, Vector3{ 0.0f, 0.0f, -1.0f }, matLambert_GrayBlue);; //Back
@@ -402,12 +725,6 @@ namespace dae {
 			m->RotateY(yawAngle);
 			m->UpdateTransforms();
 		}
-
-		for (auto& mesh : m_pMeshes)
-		{
-			mesh->UpdateAABB();
-			mesh->UpdateTransforms();
-		}
 	}
 
 	void Scene_W4_BunnyScene::Initialize()
@@ -416,8 +733,8 @@ namespace dae {
 		m_Camera.origin = { 0.f, 3.0f, -9.0f };
 		m_Camera.SetFovAngle(45.f);
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.0f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.0f));
+		const auto matLambert_White = AddMaterial(Material_Lambert(colors::White, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.0f, 0.0f, 10.0f }, Vector3{ 0.0f, 0.0f, -1.0f }, matLambert_GrayBlue);; //Back
@@ -428,7 +745,7 @@ namespace dae {
 
 
 		m_pBunny = AddTriangleMesh(dae::TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny2.obj", m_pBunny->positions, m_pBunny->normals, m_pBunny->indices);
+		MeshCache::LoadOBJ("Resources/lowpoly_bunny2.obj", *m_pBunny);
 
 		m_pBunny->Scale({ 2.f,2.f,2.f });
 
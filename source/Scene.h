@@ -5,15 +5,16 @@
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "Material.h"
 
 namespace dae
 {
 	//Forward Declarations
 	class Timer;
-	class Material;
 	struct Plane;
 	struct Sphere;
 	struct Light;
+	struct RayPacket;
 
 	//Scene Base Class
 	class Scene
@@ -34,13 +35,22 @@ namespace dae
 		}
 
 		Camera& GetCamera() { return m_Camera; }
+		// Changes whenever objects are added, moved or deformed, the camera has a version of its own
+		uint32_t GetVersion() const;
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
+		// Closest hit of every ray in the packet (closestHits holds packet.count records), traced through the BVHs together
+		void GetClosestHit(const RayPacket& packet, HitRecord* closestHits) const;
 		bool DoesHit(const Ray& ray) const;
+		// Any-hit of every ray in the packet (occluded holds packet.count flags)
+		void DoesHit(const RayPacket& packet, bool* occluded) const;
+
+		// Rebuilds the top level BVH when objects were added, refits it otherwise (call after Update, before tracing)
+		void UpdateAccelerationStructure();
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
-		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		const std::vector<Material>& GetMaterials() const { return m_Materials; }
 
 	protected:
 		std::string	sceneName;
@@ -48,21 +58,54 @@ namespace dae
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
 		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
+		//Shared geometry, only rendered through instances
+		std::vector<TriangleMesh> m_Meshes{};
+		std::vector<MeshInstance> m_MeshInstances{};
 		std::vector<Light> m_Lights{};
-		std::vector<Material*> m_Materials{};
+		std::vector<Material> m_Materials{};
 
 		//Temp (Individual Triangle Testing)
 		std::vector<Triangle> m_Triangles{};
 
+		//Top level acceleration structure over every bounded object (planes are unbounded and stay a flat list)
+		enum class ObjectType
+		{
+			Sphere,
+			TriangleMesh,
+			MeshInstance
+		};
+
+		struct ObjectReference
+		{
+			ObjectType type{};
+			uint32_t index{};
+		};
+
+		std::vector<ObjectReference> m_BoundedObjects{};
+		BVH m_TopLevelBVH{};
+		// 4-wide copy of the top-level BVH that is actually traversed, follows every build and refit
+		WideBVH m_TopLevelWideBVH{};
+		float m_TopLevelRebuildThreshold{ 1.25f };
+
 		Camera m_Camera{};
+		// Spheres and planes have no version, an Update that edits them in place has to bump this one
+		uint32_t m_Version{};
 
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
 
+		// Instancing: fill the mesh returned by GetMesh once, then place it as often as needed
+		MeshHandle AddMesh(TriangleCullMode cullMode);
+		TriangleMesh& GetMesh(MeshHandle meshHandle) { return m_Meshes[meshHandle]; }
+		MeshInstance* AddMeshInstance(MeshHandle meshHandle, const Matrix& transform, unsigned char materialIndex = 0);
+
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
-		unsigned char AddMaterial(Material* pMaterial);
+		unsigned char AddMaterial(const Material& material);
+
+	private:
+		void GetObjectBounds(std::vector<Vector3>& minBounds, std::vector<Vector3>& maxBounds) const;
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -186,5 +229,28 @@ namespace dae
 		TriangleMesh* m_pBunny{ nullptr };
 	};
 
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Scene described by a text file (see Resources/Reference.scene for the statements), the meshes it references load in parallel
+	class Scene_File final : public Scene
+	{
+	public:
+		// Mesh paths inside the file are relative to the file itself
+		explicit Scene_File(const std::string& filePath) : m_FilePath{ filePath } {}
+		~Scene_File() override = default;
+
+		Scene_File(const Scene_File&) = delete;
+		Scene_File(Scene_File&&) noexcept = delete;
+		Scene_File& operator=(const Scene_File&) = delete;
+		Scene_File& operator=(Scene_File&&) noexcept = delete;
+
+		void Initialize() override;
+		// False when the file or one of its meshes could not be read, the reason is printed to the console
+		bool IsLoaded() const { return m_IsLoaded; }
+
+	private:
+		std::string m_FilePath{};
+		bool m_IsLoaded{ false };
+	};
+
 
 }
@@ -0,0 +1,282 @@
+#include "Scene.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+namespace dae
+{
+	namespace
+	{
+		// Where a loaded OBJ ends up, an OBJ referenced more than once is still only loaded once
+		struct MeshTarget
+		{
+			bool isShared{};
+			// In m_Meshes when shared, in m_TriangleMeshGeometries otherwise
+			uint32_t meshIndex{};
+			size_t fileIndex{};
+
+			TriangleCullMode cullMode{};
+			unsigned char materialIndex{};
+			Matrix scaleTransform{};
+			Matrix rotationTransform{};
+			Matrix translationTransform{};
+		};
+
+		bool ReadVector(std::istringstream& stream, Vector3& vector)
+		{
+			return static_cast<bool>(stream >> vector.x >> vector.y >> vector.z);
+		}
+
+		bool ReadColor(std::istringstream& stream, ColorRGB& color)
+		{
+			return static_cast<bool>(stream >> color.r >> color.g >> color.b);
+		}
+
+		bool ReadCullMode(std::istringstream& stream, TriangleCullMode& cullMode)
+		{
+			std::string name{};
+			if (!(stream >> name)) return false;
+
+			if (name == "back") cullMode = TriangleCullMode::BackFaceCulling;
+			else if (name == "front") cullMode = TriangleCullMode::FrontFaceCulling;
+			else if (name == "none") cullMode = TriangleCullMode::NoCulling;
+			else return false;
+			return true;
+		}
+
+		// Any of "translate x y z", "rotate pitch yaw roll" (degrees) and "scale x y z" up to the end of the line
+		bool ReadTransform(std::istringstream& stream, Matrix& scaleTransform, Matrix& rotationTransform, Matrix& translationTransform)
+		{
+			std::string keyword{};
+			while (stream >> keyword)
+			{
+				Vector3 values{};
+				if (!ReadVector(stream, values)) return false;
+
+				if (keyword == "translate") translationTransform = Matrix::CreateTranslation(values);
+				else if (keyword == "rotate") rotationTransform = Matrix::CreateRotation(values * TO_RADIANS);
+				else if (keyword == "scale") scaleTransform = Matrix::CreateScale(values);
+				else return false;
+			}
+			return true;
+		}
+
+		std::optional<Material> ReadMaterial(std::istringstream& stream)
+		{
+			std::string type{};
+			ColorRGB color{};
+			if (!(stream >> type) || !ReadColor(stream, color)) return std::nullopt;
+
+			if (type == "solid") return Material_SolidColor{ color };
+
+			float values[3]{};
+			if (type == "lambert" && stream >> values[0]) return Material_Lambert{ color, values[0] };
+			if (type == "lambertphong" && stream >> values[0] >> values[1] >> values[2]) return Material_LambertPhong{ color, values[0], values[1], values[2] };
+			if (type == "cooktorrance" && stream >> values[0] >> values[1]) return Material_CookTorrence{ color, values[0], values[1] };
+			return std::nullopt;
+		}
+	}
+
+	void Scene_File::Initialize()
+	{
+		TRACE_ZONE("Scene_File::Initialize");
+		m_IsLoaded = false;
+
+		std::ifstream file{ m_FilePath };
+		if (!file)
+		{
+			std::cout << "Could not open scene " << m_FilePath << '\n';
+			return;
+		}
+		const std::filesystem::path directory{ std::filesystem::path{ m_FilePath }.parent_path() };
+
+		// The first material (solid red) is the default of every scene
+		std::unordered_map<std::string, unsigned char> materials{ { "default", 0 } };
+		std::unordered_map<std::string, MeshHandle> meshes{};
+		std::vector<std::string> meshFiles{};
+		std::unordered_map<std::string, size_t> meshFileIndices{};
+		std::vector<MeshTarget> meshTargets{};
+
+		const auto getFileIndex = [&](const std::string& relativePath)
+			{
+				const std::string meshFile{ (directory / relativePath).string() };
+				const auto [it, isNew] { meshFileIndices.try_emplace(meshFile, meshFiles.size()) };
+				if (isNew) meshFiles.push_back(meshFile);
+				return it->second;
+			};
+
+		// Everything except the meshes is added while reading, the meshes are only referenced until the loop below
+		int lineNumber{ 0 };
+		std::string line{};
+		while (std::getline(file, line))
+		{
+			++lineNumber;
+			const size_t commentStart{ line.find('#') };
+			if (commentStart != std::string::npos) line.erase(commentStart);
+
+			std::istringstream stream{ line };
+			std::string keyword{};
+			if (!(stream >> keyword)) continue;
+
+			bool isValid{ true };
+			std::string name{};
+			if (keyword == "name")
+			{
+				isValid = static_cast<bool>(std::getline(stream >> std::ws, sceneName));
+			}
+			else if (keyword == "camera")
+			{
+				// camera x y z fov [forward x y z]
+				Vector3 origin{};
+				float fovAngle{};
+				isValid = ReadVector(stream, origin) && stream >> fovAngle;
+				if (isValid)
+				{
+					m_Camera.origin = origin;
+					m_Camera.SetFovAngle(fovAngle);
+				}
+
+				std::string option{};
+				Vector3 forward{};
+				if (isValid && stream >> option)
+				{
+					isValid = option == "forward" && ReadVector(stream, forward) && forward.SqrMagnitude() > 0.f;
+					if (isValid) m_Camera.forward = forward.Normalized();
+				}
+			}
+			else if (keyword == "material")
+			{
+				// material name type r g b parameters...
+				std::optional<Material> material{};
+				isValid = stream >> name && !materials.contains(name) && m_Materials.size() < 256 && (material = ReadMaterial(stream)).has_value();
+				if (isValid) materials[name] = AddMaterial(*material);
+			}
+			else if (keyword == "plane" || keyword == "sphere")
+			{
+				// plane x y z nx ny nz material / sphere x y z radius material
+				Vector3 origin{}, normal{};
+				float radius{};
+				isValid = ReadVector(stream, origin) && (keyword == "plane" ? ReadVector(stream, normal) : static_cast<bool>(stream >> radius)) && stream >> name && materials.contains(name);
+				if (isValid && keyword == "plane") AddPlane(origin, normal.Normalized(), materials[name]);
+				else if (isValid) AddSphere(origin, radius, materials[name]);
+			}
+			else if (keyword == "pointlight" || keyword == "directionallight")
+			{
+				// pointlight x y z intensity r g b / directionallight dx dy dz intensity r g b
+				Vector3 vector{};
+				float intensity{};
+				ColorRGB color{};
+				isValid = ReadVector(stream, vector) && stream >> intensity && ReadColor(stream, color);
+				if (isValid && keyword == "pointlight") AddPointLight(vector, intensity, color);
+				else if (isValid) AddDirectionalLight(vector.Normalized(), intensity, color);
+			}
+			else if (keyword == "mesh")
+			{
+				// mesh name file.obj cull, only drawn through instances
+				std::string meshFile{};
+				MeshTarget target{};
+				isValid = stream >> name >> meshFile && !meshes.contains(name) && ReadCullMode(stream, target.cullMode);
+				if (isValid)
+				{
+					const MeshHandle meshHandle{ AddMesh(target.cullMode) };
+					meshes[name] = meshHandle;
+					target.isShared = true;
+					target.meshIndex = meshHandle;
+					target.fileIndex = getFileIndex(meshFile);
+					meshTargets.push_back(target);
+				}
+			}
+			else if (keyword == "object")
+			{
+				// object file.obj cull material [transform]
+				std::string meshFile{};
+				MeshTarget target{};
+				isValid = stream >> meshFile && ReadCullMode(stream, target.cullMode) && stream >> name && materials.contains(name)
+					&& ReadTransform(stream, target.scaleTransform, target.rotationTransform, target.translationTransform);
+				if (isValid)
+				{
+					target.materialIndex = materials[name];
+					AddTriangleMesh(target.cullMode, target.materialIndex);
+					target.meshIndex = static_cast<uint32_t>(m_TriangleMeshGeometries.size() - 1);
+					target.fileIndex = getFileIndex(meshFile);
+					meshTargets.push_back(target);
+				}
+			}
+			else if (keyword == "instance")
+			{
+				// instance mesh material [transform]
+				std::string materialName{};
+				Matrix scaleTransform{}, rotationTransform{}, translationTransform{};
+				isValid = stream >> name >> materialName && meshes.contains(name) && materials.contains(materialName)
+					&& ReadTransform(stream, scaleTransform, rotationTransform, translationTransform);
+				if (isValid) AddMeshInstance(meshes[name], scaleTransform * rotationTransform * translationTransform, materials[materialName]);
+			}
+			else
+			{
+				isValid = false;
+			}
+
+			// Anything left over is a typo as well
+			std::string remainder{};
+			if (!isValid || stream >> remainder)
+			{
+				std::cout << m_FilePath << '(' << lineNumber << "): invalid " << keyword << " statement\n";
+				return;
+			}
+		}
+
+		// Parsing and building the BVH of every OBJ (or reading its cache) is independent work
+		// A single OBJ is split up itself instead, the pool cannot dispatch from inside one of its own tasks
+		std::vector<TriangleMesh> loadedMeshes(meshFiles.size());
+		std::vector<char> isMeshLoaded(meshFiles.size());
+		if (!meshFiles.empty())
+		{
+			ThreadPool threadPool{};
+			if (meshFiles.size() > 1)
+			{
+				threadPool.Dispatch(static_cast<unsigned int>(meshFiles.size()), [&](unsigned int fileIndex)
+					{
+						isMeshLoaded[fileIndex] = MeshCache::LoadOBJ(meshFiles[fileIndex], loadedMeshes[fileIndex]);
+					});
+			}
+			else
+			{
+				isMeshLoaded[0] = MeshCache::LoadOBJ(meshFiles[0], loadedMeshes[0], &threadPool);
+			}
+		}
+
+		for (size_t i{ 0 }; i < meshFiles.size(); ++i)
+		{
+			if (!isMeshLoaded[i])
+			{
+				std::cout << "Could not load mesh " << meshFiles[i] << " of scene " << m_FilePath << '\n';
+				return;
+			}
+		}
+
+		for (const MeshTarget& target : meshTargets)
+		{
+			TriangleMesh& mesh{ target.isShared ? m_Meshes[target.meshIndex] : m_TriangleMeshGeometries[target.meshIndex] };
+			mesh = loadedMeshes[target.fileIndex];
+			mesh.cullMode = target.cullMode;
+			mesh.materialIndex = target.materialIndex;
+
+			// Shared meshes stay in object space, UpdateAccelerationStructure picks them up
+			if (target.isShared) continue;
+			mesh.scaleTransform = target.scaleTransform;
+			mesh.rotationTransform = target.rotationTransform;
+			mesh.translationTransform = target.translationTransform;
+			mesh.UpdateTransforms();
+		}
+
+		m_IsLoaded = true;
+	}
+}
\ No newline at end of file
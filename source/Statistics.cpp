@@ -0,0 +1,73 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace dae
+{
+	namespace Statistics
+	{
+		namespace
+		{
+			std::mutex g_RegistryMutex{};
+			std::vector<Counters*> g_RegisteredCounters{};
+			// Counts of threads that exited since the last collect
+			Counters g_RetiredCounters{};
+			thread_local bool g_IsThreadRegistered{};
+		}
+
+		void RegisterThread()
+		{
+			if (g_IsThreadRegistered) return;
+
+			std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+			g_RegisteredCounters.push_back(&g_ThreadCounters);
+			g_IsThreadRegistered = true;
+		}
+
+		void UnregisterThread()
+		{
+			if (!g_IsThreadRegistered) return;
+
+			std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+			g_RetiredCounters += g_ThreadCounters;
+			g_ThreadCounters = {};
+			g_RegisteredCounters.erase(std::find(g_RegisteredCounters.begin(), g_RegisteredCounters.end(), &g_ThreadCounters));
+			g_IsThreadRegistered = false;
+		}
+
+		Counters CollectCounters()
+		{
+			std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+
+			Counters total{ g_RetiredCounters };
+			g_RetiredCounters = {};
+			for (Counters* pCounters : g_RegisteredCounters)
+			{
+				total += *pCounters;
+				*pCounters = {};
+			}
+			return total;
+		}
+
+		std::string FormatReport(const Counters& counters, float seconds)
+		{
+			const uint64_t nrRays{ counters.GetNrRays() };
+			const double raysPerRay{ nrRays > 0 ? 1.0 / nrRays : 0.0 };
+
+			std::ostringstream report{};
+			report << std::fixed << std::setprecision(2)
+				<< "Rays: " << (seconds > 0.f ? nrRays / (seconds * 1e6) : 0.0) << " M/s"
+				<< " (primary " << counters[Counter::PrimaryRays]
+				<< ", secondary " << counters.GetNrSecondaryRays()
+				<< ", shadow " << counters[Counter::ShadowRays] << ")"
+				<< " | " << counters[Counter::NodeVisits] * raysPerRay << " nodes/ray"
+				<< " | " << counters[Counter::PrimitiveTests] * raysPerRay << " tests/ray"
+				<< " | " << counters[Counter::Hits] * raysPerRay * 100.0 << "% hits";
+			return report.str();
+		}
+	}
+}
\ No newline at end of file
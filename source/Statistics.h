@@ -0,0 +1,102 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "SIMD.h"
+
+// Opt-in: counts rays, node visits, primitive tests and hits. Without it every STATS_ macro compiles to nothing
+//#define RAY_STATISTICS
+
+namespace dae
+{
+	namespace Statistics
+	{
+		enum class Counter : uint32_t
+		{
+			PrimaryRays,	// Camera rays
+			ClosestHitRays,	// Every closest hit query, primary rays included
+			ShadowRays,		// Any-hit queries
+			NodeVisits,		// BVH nodes popped during traversal, a packet visiting a node counts once
+			PrimitiveTests,	// Spheres, planes and triangles intersected
+			Hits,			// Closest hit queries that hit something and shadow rays that were blocked
+
+			Count
+		};
+
+		struct Counters
+		{
+			uint64_t values[static_cast<uint32_t>(Counter::Count)]{};
+
+			uint64_t& operator[](Counter counter) { return values[static_cast<uint32_t>(counter)]; }
+			uint64_t operator[](Counter counter) const { return values[static_cast<uint32_t>(counter)]; }
+
+			Counters& operator+=(const Counters& other)
+			{
+				for (uint32_t i{ 0 }; i < static_cast<uint32_t>(Counter::Count); ++i) values[i] += other.values[i];
+				return *this;
+			}
+
+			uint64_t GetNrRays() const { return (*this)[Counter::ClosestHitRays] + (*this)[Counter::ShadowRays]; }
+			// Closest hit queries that did not come from the camera (reflections, ...)
+			uint64_t GetNrSecondaryRays() const { return (*this)[Counter::ClosestHitRays] - (*this)[Counter::PrimaryRays]; }
+		};
+
+		// Constant initialized, so the STATS_ macros reach it as a plain thread local access without an init guard or call
+		inline thread_local Counters g_ThreadCounters{};
+
+		// Counters of the calling thread, CollectCounters only sees them once the thread is registered
+		inline Counters& GetThreadCounters()
+		{
+			return g_ThreadCounters;
+		}
+
+		// Makes the counters of the calling thread visible to CollectCounters, registering again does nothing
+		void RegisterThread();
+		// Hands the counts of the calling thread over to the next CollectCounters, must happen before the thread exits
+		void UnregisterThread();
+
+		// Keeps the calling thread registered for as long as it lives, for the worker threads
+		struct ThreadRegistration
+		{
+			ThreadRegistration() { RegisterThread(); }
+			~ThreadRegistration() { UnregisterThread(); }
+
+			ThreadRegistration(const ThreadRegistration&) = delete;
+			ThreadRegistration(ThreadRegistration&&) noexcept = delete;
+			ThreadRegistration& operator=(const ThreadRegistration&) = delete;
+			ThreadRegistration& operator=(ThreadRegistration&&) noexcept = delete;
+		};
+
+		inline void Add(Counter counter, uint64_t amount)
+		{
+			GetThreadCounters()[counter] += amount;
+		}
+
+		/**
+		 * \brief Sums the counters of every thread and resets them
+		 * Only call while no thread is tracing (between frames), the counters themselves are not atomic
+		 */
+		Counters CollectCounters();
+
+		// One line with rays/sec, the ray mix and tests per ray
+		std::string FormatReport(const Counters& counters, float seconds);
+
+		// CPU time stamp counter, nanoseconds where there is none. Only meaningful as a difference on the same thread
+		inline uint64_t ReadCycleCounter()
+		{
+#if defined(SIMD_X86)
+			return __rdtsc();
+#else
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+		}
+	}
+}
+
+#ifdef RAY_STATISTICS
+#define STATS_ADD(counter, amount) ::dae::Statistics::Add(::dae::Statistics::Counter::counter, (amount))
+#else
+#define STATS_ADD(counter, amount) ((void)0)
+#endif
+#define STATS_INCREMENT(counter) STATS_ADD(counter, 1)
\ No newline at end of file
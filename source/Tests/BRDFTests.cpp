@@ -0,0 +1,134 @@
+//Standard includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+//Project includes
+#include "BRDFs.h"
+#include "SIMD.h"
+
+using namespace dae;
+
+// Compares the batch version of BRDF::CookTorrance (AVX2 when the CPU has it) with the scalar overload, lane by lane
+namespace
+{
+	constexpr int g_NrBatchesPerCount{ 200 };
+
+	struct MaterialCase
+	{
+		const char* name;
+		ColorRGB albedo;
+		float metalness;
+		float roughness;
+	};
+
+	// Metals and dielectrics, from mirror-like to fully rough
+	const MaterialCase g_MaterialCases[]
+	{
+		{ "Copper", { 0.955f, 0.637f, 0.538f }, 1.f, 0.1f },
+		{ "Gold", { 1.f, 0.782f, 0.344f }, 1.f, 0.6f },
+		{ "RoughSilver", { 0.972f, 0.960f, 0.915f }, 1.f, 1.f },
+		{ "SmoothPlastic", { 0.75f, 0.75f, 0.75f }, 0.f, 0.05f },
+		{ "RedPlastic", { 0.8f, 0.1f, 0.1f }, 0.f, 0.5f },
+		{ "Chalk", { 0.95f, 0.95f, 0.9f }, 0.f, 1.f }
+	};
+
+	class BatchGenerator final
+	{
+	public:
+		explicit BatchGenerator(unsigned int seed) : m_Engine(seed) {}
+
+		// Random directions, so some lights and views lie behind the surface and the dot products clamp to 0
+		void Generate(uint32_t count, ShadingBatch& batch)
+		{
+			batch.count = 0;
+			for (uint32_t i{ 0 }; i < count; ++i)
+			{
+				batch.Add(RandomDirection(), RandomDirection(), RandomDirection());
+			}
+		}
+
+	private:
+		std::mt19937 m_Engine;
+
+		float Random(float min, float max)
+		{
+			return std::uniform_real_distribution<float>{ min, max }(m_Engine);
+		}
+
+		Vector3 RandomDirection()
+		{
+			Vector3 direction{};
+			do
+			{
+				direction = { Random(-1.f, 1.f), Random(-1.f, 1.f), Random(-1.f, 1.f) };
+			} while (direction.SqrMagnitude() < 0.01f);
+			return direction.Normalized();
+		}
+	};
+
+	// Bit for bit, the kernels run the same operations in the same order (as long as the compiler does not fuse multiply-adds, e.g. -march=native)
+	bool IsSameChannel(float value, float expectedValue)
+	{
+		return value == expectedValue || (std::isnan(value) && std::isnan(expectedValue));
+	}
+
+	bool IsSameColor(const ColorRGB& color, const ColorRGB& expectedColor)
+	{
+		return IsSameChannel(color.r, expectedColor.r) && IsSameChannel(color.g, expectedColor.g) && IsSameChannel(color.b, expectedColor.b);
+	}
+}
+
+int main()
+{
+	if (SIMD::GetSIMDLevel() != SIMDLevel::AVX2)
+	{
+		std::cout << "The CPU does not support AVX2, only the scalar remainder loop is tested\n";
+	}
+
+	constexpr int maxReportedFailures{ 10 };
+
+	BatchGenerator generator{ 1234u };
+	ShadingBatch batch{};
+	ColorRGB colors[g_ShadingBatchSize]{};
+	int nrFailures{ 0 };
+	for (const MaterialCase& materialCase : g_MaterialCases)
+	{
+		const BRDF::CookTorranceConstants constants{ materialCase.albedo, materialCase.metalness, materialCase.roughness };
+
+		// Every count, so full 8 lane steps, remainders and batches below 8 are all covered
+		int nrSamples{ 0 };
+		for (uint32_t count{ 1 }; count <= g_ShadingBatchSize; ++count)
+		{
+			for (int batchIndex{ 0 }; batchIndex < g_NrBatchesPerCount; ++batchIndex)
+			{
+				generator.Generate(count, batch);
+				BRDF::CookTorrance(constants, batch, colors);
+				nrSamples += static_cast<int>(count);
+
+				for (uint32_t i{ 0 }; i < count; ++i)
+				{
+					const ColorRGB expectedColor{ BRDF::CookTorrance(constants, batch.GetNormal(i), batch.GetLightDirection(i), batch.GetViewDirection(i)) };
+					if (IsSameColor(colors[i], expectedColor)) continue;
+
+					if (++nrFailures <= maxReportedFailures)
+					{
+						std::cout << materialCase.name << ", count " << count << ", sample " << i
+							<< ": (" << colors[i].r << ", " << colors[i].g << ", " << colors[i].b << ")"
+							<< ", expected (" << expectedColor.r << ", " << expectedColor.g << ", " << expectedColor.b << ")\n";
+					}
+				}
+			}
+		}
+		std::cout << materialCase.name << ": " << nrSamples << " samples\n";
+	}
+
+	if (nrFailures > 0)
+	{
+		std::cout << nrFailures << " mismatch(es)\n";
+		return EXIT_FAILURE;
+	}
+	std::cout << "The batch kernel matches the scalar Cook-Torrance\n";
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+//Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//Project includes
+#include "TriangleBlocks.h"
+#include "Utils.h"
+
+using namespace dae;
+
+// Compares every kernel of TriangleBlockUtils::IntersectTriangleBlock with GeometryUtils::HitTest_Triangle, which the blocks replace during traversal
+namespace
+{
+	constexpr int g_NrBlocksPerCullMode{ 20000 };
+	// The kernels run the same operations in the same order, but a compiler that fuses multiply-adds moves t a little on grazing triangles
+	constexpr float g_RelativeTolerance{ 1e-4f };
+
+	const char* GetSIMDLevelName(SIMDLevel level)
+	{
+		switch (level)
+		{
+		case SIMDLevel::Scalar:
+			return "Scalar";
+		case SIMDLevel::SSE:
+			return "SSE";
+		case SIMDLevel::AVX2:
+			return "AVX2";
+		}
+		return "Unknown";
+	}
+
+	const char* GetCullModeName(TriangleCullMode cullMode)
+	{
+		switch (cullMode)
+		{
+		case TriangleCullMode::FrontFaceCulling:
+			return "FrontFaceCulling";
+		case TriangleCullMode::BackFaceCulling:
+			return "BackFaceCulling";
+		case TriangleCullMode::NoCulling:
+			return "NoCulling";
+		}
+		return "Unknown";
+	}
+
+	struct TestCase
+	{
+		Vector3 origin{};
+		Vector3 direction{};
+		float tMin{ 0.0001f };
+		float tMax{ FLT_MAX };
+		TriangleCullMode cullMode{};
+
+		Triangle triangles[g_TriangleBlockSize]{};
+		TriangleBlock block{};
+	};
+
+	class TestCaseGenerator final
+	{
+	public:
+		explicit TestCaseGenerator(unsigned int seed) : m_Engine(seed) {}
+
+		void Generate(TriangleCullMode cullMode, TestCase& testCase)
+		{
+			testCase = {};
+			testCase.cullMode = cullMode;
+			testCase.origin = RandomVector(10.f);
+			testCase.direction = RandomDirection();
+			// A finite tMax clips some of the hits
+			if (Random(0.f, 1.f) < 0.25f) testCase.tMax = Random(1.f, 10.f);
+
+			testCase.block.count = 1 + static_cast<uint32_t>(Random(0.f, 1.f) * g_TriangleBlockSize) % g_TriangleBlockSize;
+			for (uint32_t lane{ 0 }; lane < testCase.block.count; ++lane)
+			{
+				// Around a point on the ray, so most rays hit something in the block
+				const Vector3 center{ testCase.origin + testCase.direction * Random(-2.f, 15.f) + RandomVector(0.5f) };
+
+				Triangle& triangle{ testCase.triangles[lane] };
+				if (Random(0.f, 1.f) < 0.25f)
+				{
+					// Edge-on, the ray direction lies in the plane of the triangle
+					const Vector3 v0{ center + RandomVector(0.2f) };
+					triangle = Triangle{ v0, v0 + testCase.direction * Random(0.1f, 2.f), v0 + RandomDirection() * Random(0.1f, 2.f) };
+				}
+				else
+				{
+					triangle = Triangle{ center + RandomVector(2.f), center + RandomVector(2.f), center + RandomVector(2.f) };
+				}
+				triangle.cullMode = cullMode;
+
+				// The same layout TriangleBlockList::Build writes
+				const Vector3 edge1{ triangle.v1 - triangle.v0 };
+				const Vector3 edge2{ triangle.v2 - triangle.v0 };
+				TriangleBlock& block{ testCase.block };
+				block.v0x[lane] = triangle.v0.x;
+				block.v0y[lane] = triangle.v0.y;
+				block.v0z[lane] = triangle.v0.z;
+				block.edge1x[lane] = edge1.x;
+				block.edge1y[lane] = edge1.y;
+				block.edge1z[lane] = edge1.z;
+				block.edge2x[lane] = edge2.x;
+				block.edge2y[lane] = edge2.y;
+				block.edge2z[lane] = edge2.z;
+				block.normalx[lane] = triangle.normal.x;
+				block.normaly[lane] = triangle.normal.y;
+				block.normalz[lane] = triangle.normal.z;
+				block.triangleIndex[lane] = lane;
+			}
+		}
+
+	private:
+		std::mt19937 m_Engine;
+
+		float Random(float min, float max)
+		{
+			return std::uniform_real_distribution<float>{ min, max }(m_Engine);
+		}
+
+		Vector3 RandomVector(float extent)
+		{
+			return { Random(-extent, extent), Random(-extent, extent), Random(-extent, extent) };
+		}
+
+		Vector3 RandomDirection()
+		{
+			Vector3 direction{};
+			do
+			{
+				direction = RandomVector(1.f);
+			} while (direction.SqrMagnitude() < 0.01f);
+			return direction.Normalized();
+		}
+	};
+
+	// The closest hit of the block, tested one triangle at a time like the traversal without blocks
+	int FindClosestTriangle(const TestCase& testCase, float& t)
+	{
+		Ray ray{ testCase.origin, testCase.direction, testCase.tMin, testCase.tMax };
+		int closestLane{ -1 };
+		for (uint32_t lane{ 0 }; lane < testCase.block.count; ++lane)
+		{
+			HitRecord hitRecord{};
+			if (!GeometryUtils::HitTest_Triangle(testCase.triangles[lane], ray, hitRecord)) continue;
+
+			ray.max = hitRecord.t;
+			closestLane = static_cast<int>(lane);
+		}
+		if (closestLane != -1) t = ray.max;
+		return closestLane;
+	}
+
+	bool IsSameDistance(float t, float expectedT)
+	{
+		return std::abs(t - expectedT) <= g_RelativeTolerance * std::max(1.f, std::abs(expectedT));
+	}
+}
+
+int main()
+{
+	std::vector<SIMDLevel> levels{ SIMDLevel::Scalar };
+#if defined(SIMD_X86)
+	levels.push_back(SIMDLevel::SSE);
+	if (SIMD::GetSIMDLevel() == SIMDLevel::AVX2)
+	{
+		levels.push_back(SIMDLevel::AVX2);
+	}
+	else
+	{
+		std::cout << "Skipping AVX2, the CPU does not support it\n";
+	}
+#endif
+
+	constexpr TriangleCullMode cullModes[]{ TriangleCullMode::FrontFaceCulling, TriangleCullMode::BackFaceCulling, TriangleCullMode::NoCulling };
+	constexpr int maxReportedFailures{ 10 };
+
+	TestCaseGenerator generator{ 1234u };
+	TestCase testCase{};
+	int nrFailures{ 0 };
+	for (TriangleCullMode cullMode : cullModes)
+	{
+		int nrHits{ 0 };
+		for (int blockIndex{ 0 }; blockIndex < g_NrBlocksPerCullMode; ++blockIndex)
+		{
+			generator.Generate(cullMode, testCase);
+
+			float expectedT{ FLT_MAX };
+			const int expectedLane{ FindClosestTriangle(testCase, expectedT) };
+			if (expectedLane != -1) ++nrHits;
+
+			for (SIMDLevel level : levels)
+			{
+				float t{ FLT_MAX };
+				const int lane{ TriangleBlockUtils::IntersectTriangleBlock(testCase.block, testCase.origin, testCase.direction, testCase.tMin, testCase.tMax, cullMode, t, level) };
+				if (lane == expectedLane && (lane == -1 || IsSameDistance(t, expectedT))) continue;
+
+				if (++nrFailures <= maxReportedFailures)
+				{
+					std::cout << GetSIMDLevelName(level) << ", " << GetCullModeName(cullMode) << ", block " << blockIndex
+						<< ": lane " << lane << " t " << t << ", expected lane " << expectedLane << " t " << expectedT << '\n';
+				}
+			}
+		}
+		std::cout << GetCullModeName(cullMode) << ": " << g_NrBlocksPerCullMode << " blocks, " << nrHits << " with a hit\n";
+	}
+
+	if (nrFailures > 0)
+	{
+		std::cout << nrFailures << " mismatch(es)\n";
+		return EXIT_FAILURE;
+	}
+	std::cout << "All kernels match the scalar hit test\n";
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "ThreadPool.h"
+
+#include <string>
+
+#include "Statistics.h"
+#include "Trace.h"
+
+namespace dae
+{
+	ThreadPool::ThreadPool(unsigned int nrThreads)
+	{
+		if (nrThreads == 0) nrThreads = std::thread::hardware_concurrency();
+		if (nrThreads == 0) nrThreads = 1;
+
+		m_Queues.reserve(nrThreads);
+		for (unsigned int i{ 0 }; i < nrThreads; ++i)
+		{
+			m_Queues.push_back(std::make_unique<WorkQueue>());
+		}
+
+		// Worker 0 is whichever thread calls Dispatch
+		m_Workers.reserve(nrThreads - 1);
+		for (unsigned int i{ 1 }; i < nrThreads; ++i)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_Stop = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::Dispatch(unsigned int nrTasks, const std::function<void(unsigned int)>& task)
+	{
+		if (nrTasks == 0) return;
+
+		// Published before any task becomes visible, the queue mutexes order it for the workers
+		m_pTask = &task;
+		m_NrRemainingTasks = nrTasks;
+
+		const unsigned int nrQueues{ GetNrThreads() };
+		for (unsigned int queueIndex{ 0 }; queueIndex < nrQueues; ++queueIndex)
+		{
+			const unsigned int firstTask{ static_cast<unsigned int>(static_cast<uint64_t>(nrTasks) * queueIndex / nrQueues) };
+			const unsigned int endTask{ static_cast<unsigned int>(static_cast<uint64_t>(nrTasks) * (queueIndex + 1) / nrQueues) };
+
+			WorkQueue& queue{ *m_Queues[queueIndex] };
+			std::lock_guard<std::mutex> lock{ queue.mutex };
+			for (unsigned int taskIndex{ firstTask }; taskIndex < endTask; ++taskIndex)
+			{
+				queue.tasks.push_back(taskIndex);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			++m_Generation;
+		}
+		m_WakeCondition.notify_all();
+
+		RunTasks(0);
+
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this] { return m_NrRemainingTasks == 0; });
+		m_pTask = nullptr;
+	}
+
+	void ThreadPool::WorkerLoop(unsigned int workerIndex)
+	{
+		Trace::SetThreadName("Worker " + std::to_string(workerIndex));
+#ifdef RAY_STATISTICS
+		const Statistics::ThreadRegistration statisticsRegistration{};
+#endif
+
+		uint64_t handledGeneration{};
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ m_Mutex };
+				m_WakeCondition.wait(lock, [&] { return m_Stop || m_Generation != handledGeneration; });
+				if (m_Stop) return;
+				handledGeneration = m_Generation;
+			}
+
+			RunTasks(workerIndex);
+		}
+	}
+
+	void ThreadPool::RunTasks(unsigned int workerIndex)
+	{
+		unsigned int taskIndex{};
+		while (PopTask(workerIndex, taskIndex))
+		{
+			(*m_pTask)(taskIndex);
+
+			if (m_NrRemainingTasks.fetch_sub(1) == 1)
+			{
+				// Locked so the dispatching thread cannot miss the wake up between its check and its wait
+				std::lock_guard<std::mutex> lock{ m_Mutex };
+				m_DoneCondition.notify_all();
+			}
+		}
+	}
+
+	bool ThreadPool::PopTask(unsigned int workerIndex, unsigned int& taskIndex)
+	{
+		{
+			WorkQueue& ownQueue{ *m_Queues[workerIndex] };
+			std::lock_guard<std::mutex> lock{ ownQueue.mutex };
+			if (!ownQueue.tasks.empty())
+			{
+				taskIndex = ownQueue.tasks.front();
+				ownQueue.tasks.pop_front();
+				return true;
+			}
+		}
+
+		// Steal from the far end of another worker's range, away from where that worker is busy
+		const unsigned int nrQueues{ GetNrThreads() };
+		for (unsigned int offset{ 1 }; offset < nrQueues; ++offset)
+		{
+			WorkQueue& victimQueue{ *m_Queues[(workerIndex + offset) % nrQueues] };
+			std::lock_guard<std::mutex> lock{ victimQueue.mutex };
+			if (!victimQueue.tasks.empty())
+			{
+				taskIndex = victimQueue.tasks.back();
+				victimQueue.tasks.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Persistent worker threads that run indexed tasks (screen tiles, ...) through per-worker work-stealing deques
+	 * Threads are created once, a dispatch only wakes them up
+	 */
+	class ThreadPool final
+	{
+	public:
+		// 0 uses every hardware thread, the thread calling Dispatch counts as one of them
+		explicit ThreadPool(unsigned int nrThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		/**
+		 * \brief Runs task(i) for every i in [0, nrTasks) and returns once all of them are done
+		 * Every worker starts on its own contiguous range of tasks and steals from the others once it runs dry,
+		 * so a few expensive tasks do not hold up the rest
+		 */
+		void Dispatch(unsigned int nrTasks, const std::function<void(unsigned int)>& task);
+
+		unsigned int GetNrThreads() const { return static_cast<unsigned int>(m_Queues.size()); }
+
+	private:
+		// Own tasks are popped from the front, thieves take from the back
+		struct alignas(64) WorkQueue
+		{
+			std::mutex mutex{};
+			std::deque<unsigned int> tasks{};
+		};
+
+		std::vector<std::unique_ptr<WorkQueue>> m_Queues{};
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+		uint64_t m_Generation{};
+		bool m_Stop{ false };
+
+		const std::function<void(unsigned int)>* m_pTask{};
+		std::atomic<unsigned int> m_NrRemainingTasks{};
+
+		void WorkerLoop(unsigned int workerIndex);
+		void RunTasks(unsigned int workerIndex);
+		bool PopTask(unsigned int workerIndex, unsigned int& taskIndex);
+	};
+}
\ No newline at end of file
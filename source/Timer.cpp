@@ -2,22 +2,29 @@
 
 #include <iostream>
 #include <numeric>
+#include <cfloat>
 
 #include <iostream>
 #include <fstream>
+#include <chrono>
 
-#include "SDL.h"
 using namespace dae;
 
+// Ticks of the steady clock, so the timer works without SDL
+static uint64_t GetPerformanceCounter()
+{
+	return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
 Timer::Timer()
 {
-	const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
-	m_SecondsPerCount = 1.0f / static_cast<float>(countsPerSecond);
+	using Period = std::chrono::steady_clock::period;
+	m_SecondsPerCount = static_cast<float>(static_cast<double>(Period::num) / Period::den);
 }
 
 void Timer::Reset()
 {
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 
 	m_BaseTime = currentTime;
 	m_PreviousTime = currentTime;
@@ -29,7 +36,7 @@ void Timer::Reset()
 
 void Timer::Start()
 {
-	const uint64_t startTime = SDL_GetPerformanceCounter();
+	const uint64_t startTime = GetPerformanceCounter();
 
 	if (m_IsStopped)
 	{
@@ -74,7 +81,7 @@ void Timer::Update()
 		return;
 	}
 
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 	m_CurrentTime = currentTime;
 
 	m_ElapsedTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
@@ -88,7 +95,16 @@ void Timer::Update()
 		m_ElapsedTime = m_ElapsedUpperBound;
 	}
 
-	m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
+	if (m_FixedTimeStep > 0.0f)
+	{
+		// Simulated time, independent of how long the frame actually took
+		m_ElapsedTime = m_FixedTimeStep;
+		m_TotalTime += m_FixedTimeStep;
+	}
+	else
+	{
+		m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
+	}
 
 	//FPS LOGIC
 	m_FPSTimer += m_ElapsedTime;
@@ -135,7 +151,7 @@ void Timer::Stop()
 {
 	if (!m_IsStopped)
 	{
-		const uint64_t currentTime = SDL_GetPerformanceCounter();
+		const uint64_t currentTime = GetPerformanceCounter();
 
 		m_StopTime = currentTime;
 		m_IsStopped = true;
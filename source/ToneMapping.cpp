@@ -0,0 +1,182 @@
+#include "ToneMapping.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	namespace ToneMapping
+	{
+		namespace
+		{
+			// Linear [0, 1] in steps of 1/4095 to 8 bit sRGB, fine enough that neighbouring entries never skip an output value by more than one
+			constexpr int g_SRGBTableSize{ 4096 };
+
+			struct SRGBTable
+			{
+				uint8_t values[g_SRGBTableSize]{};
+
+				SRGBTable()
+				{
+					for (int i{ 0 }; i < g_SRGBTableSize; ++i)
+					{
+						const float linear{ i / static_cast<float>(g_SRGBTableSize - 1) };
+						const float encoded{ linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f };
+						values[i] = static_cast<uint8_t>(std::min(encoded, 1.f) * 255.f + 0.5f);
+					}
+				}
+			};
+
+			const SRGBTable& GetSRGBTable()
+			{
+				static const SRGBTable table{};
+				return table;
+			}
+
+			// ACES fit by Krzysztof Narkowicz
+			constexpr float g_ACESA{ 2.51f }, g_ACESB{ 0.03f }, g_ACESC{ 2.43f }, g_ACESD{ 0.59f }, g_ACESE{ 0.14f };
+
+			float ToneMapChannel(float value, ToneMapper toneMapper)
+			{
+				switch (toneMapper)
+				{
+				case ToneMapper::Reinhard:
+					return value / (1.f + value);
+				case ToneMapper::ACES:
+					return (value * (g_ACESA * value + g_ACESB)) / (value * (g_ACESC * value + g_ACESD) + g_ACESE);
+				default:
+					return value;
+				}
+			}
+
+			uint32_t EncodeChannel(float value, bool sRGB)
+			{
+				value = std::min(std::max(value, 0.f), 1.f);
+				if (sRGB) return GetSRGBTable().values[static_cast<int>(value * (g_SRGBTableSize - 1) + 0.5f)];
+				return static_cast<uint32_t>(value * 255.f);
+			}
+
+#if defined(SIMD_X86)
+			// Every step mirrors ResolvePixel, so the SSE pixels match the scalar tail exactly
+			void Resolve_SSE(const ColorRGB* pHDRPixels, uint32_t* pPixels, size_t nrPixels, const ResolveSettings& settings)
+			{
+				const __m128 exposure{ _mm_set1_ps(settings.exposure) };
+				const __m128 zero{ _mm_setzero_ps() }, one{ _mm_set1_ps(1.f) };
+				const __m128 acesA{ _mm_set1_ps(g_ACESA) }, acesB{ _mm_set1_ps(g_ACESB) }, acesC{ _mm_set1_ps(g_ACESC) }, acesD{ _mm_set1_ps(g_ACESD) }, acesE{ _mm_set1_ps(g_ACESE) };
+				const __m128 linearScale{ _mm_set1_ps(255.f) };
+				const __m128 tableScale{ _mm_set1_ps(static_cast<float>(g_SRGBTableSize - 1)) }, half{ _mm_set1_ps(0.5f) };
+				const uint8_t* pSRGBTable{ GetSRGBTable().values };
+
+				const auto toneMap = [&](__m128 value) -> __m128
+					{
+						switch (settings.toneMapper)
+						{
+						case ToneMapper::Reinhard:
+							return _mm_div_ps(value, _mm_add_ps(one, value));
+						case ToneMapper::ACES:
+							return _mm_div_ps(_mm_mul_ps(value, _mm_add_ps(_mm_mul_ps(acesA, value), acesB)),
+								_mm_add_ps(_mm_mul_ps(value, _mm_add_ps(_mm_mul_ps(acesC, value), acesD)), acesE));
+						default:
+							return value;
+						}
+					};
+
+				const auto encode = [&](__m128 value) -> __m128i
+					{
+						value = _mm_min_ps(_mm_max_ps(value, zero), one);
+						if (!settings.sRGB) return _mm_cvttps_epi32(_mm_mul_ps(value, linearScale));
+
+						alignas(16) int32_t indices[4];
+						_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, tableScale), half)));
+						return _mm_setr_epi32(pSRGBTable[indices[0]], pSRGBTable[indices[1]], pSRGBTable[indices[2]], pSRGBTable[indices[3]]);
+					};
+
+				const size_t nrVectorPixels{ nrPixels & ~static_cast<size_t>(3) };
+				for (size_t i{ 0 }; i < nrVectorPixels; i += 4)
+				{
+					// Four RGB pixels are twelve floats: r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+					const float* pColors{ &pHDRPixels[i].r };
+					const __m128 a{ _mm_loadu_ps(pColors) };
+					const __m128 b{ _mm_loadu_ps(pColors + 4) };
+					const __m128 c{ _mm_loadu_ps(pColors + 8) };
+
+					__m128 red{ _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0)) };
+					__m128 green{ _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)) };
+					__m128 blue{ _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0)) };
+
+					red = _mm_mul_ps(red, exposure);
+					green = _mm_mul_ps(green, exposure);
+					blue = _mm_mul_ps(blue, exposure);
+
+					if (settings.toneMapper == ToneMapper::MaxToOne)
+					{
+						// Dividing by one leaves the colors that are already in range untouched
+						const __m128 divisor{ _mm_max_ps(_mm_max_ps(red, _mm_max_ps(green, blue)), one) };
+						red = _mm_div_ps(red, divisor);
+						green = _mm_div_ps(green, divisor);
+						blue = _mm_div_ps(blue, divisor);
+					}
+					else
+					{
+						red = toneMap(red);
+						green = toneMap(green);
+						blue = toneMap(blue);
+					}
+
+					const __m128i packed{ _mm_or_si128(_mm_or_si128(_mm_slli_epi32(encode(red), 16), _mm_slli_epi32(encode(green), 8)), encode(blue)) };
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels + i), packed);
+				}
+
+				for (size_t i{ nrVectorPixels }; i < nrPixels; ++i)
+				{
+					pPixels[i] = ResolvePixel(pHDRPixels[i], settings);
+				}
+			}
+#endif
+		}
+
+		void Resolve(const ColorRGB* pHDRPixels, uint32_t* pPixels, size_t nrPixels, const ResolveSettings& settings)
+		{
+#if defined(SIMD_X86)
+			Resolve_SSE(pHDRPixels, pPixels, nrPixels, settings);
+#else
+			for (size_t i{ 0 }; i < nrPixels; ++i)
+			{
+				pPixels[i] = ResolvePixel(pHDRPixels[i], settings);
+			}
+#endif
+		}
+
+		uint32_t ResolvePixel(ColorRGB color, const ResolveSettings& settings)
+		{
+			color *= settings.exposure;
+			if (settings.toneMapper == ToneMapper::MaxToOne)
+			{
+				color.MaxToOne();
+			}
+			else
+			{
+				color.r = ToneMapChannel(color.r, settings.toneMapper);
+				color.g = ToneMapChannel(color.g, settings.toneMapper);
+				color.b = ToneMapChannel(color.b, settings.toneMapper);
+			}
+			return (EncodeChannel(color.r, settings.sRGB) << 16) | (EncodeChannel(color.g, settings.sRGB) << 8) | EncodeChannel(color.b, settings.sRGB);
+		}
+
+		const char* GetToneMapperName(ToneMapper toneMapper)
+		{
+			switch (toneMapper)
+			{
+			case ToneMapper::MaxToOne:
+				return "MaxToOne";
+			case ToneMapper::Reinhard:
+				return "Reinhard";
+			case ToneMapper::ACES:
+				return "ACES";
+			case ToneMapper::Count:
+				break;
+			}
+			return "Unknown";
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "ColorRGB.h"
+#include "SIMD.h"
+
+namespace dae
+{
+	enum class ToneMapper
+	{
+		MaxToOne, // Scales a color down by its brightest channel when that is above one, keeps the hue
+		Reinhard, // c / (1 + c) per channel
+		ACES,	  // Filmic curve fitted to the ACES reference
+
+		Count
+	};
+
+	// How the HDR radiance of a frame turns into displayable pixels
+	struct ResolveSettings
+	{
+		ToneMapper toneMapper{ ToneMapper::MaxToOne };
+		// Multiplies the radiance before tone mapping
+		float exposure{ 1.f };
+		// Encode with the sRGB transfer curve instead of writing linear values
+		bool sRGB{ false };
+	};
+
+	namespace ToneMapping
+	{
+		/**
+		 * \brief Tone maps the HDR colors and packs them as 0x00RRGGBB, four pixels at a time with SSE where available
+		 * \param pHDRPixels Linear radiance, read from
+		 * \param pPixels Packed output, the same number of pixels
+		 */
+		void Resolve(const ColorRGB* pHDRPixels, uint32_t* pPixels, size_t nrPixels, const ResolveSettings& settings);
+
+		// Scalar reference of Resolve for a single color
+		uint32_t ResolvePixel(ColorRGB color, const ResolveSettings& settings);
+
+		const char* GetToneMapperName(ToneMapper toneMapper);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	namespace Trace
+	{
+		namespace
+		{
+			struct ZoneEvent
+			{
+				const char* name;
+				uint64_t startTime;
+				uint64_t endTime;
+				int64_t argument;
+			};
+
+			struct ThreadBuffer
+			{
+				uint32_t threadId{};
+				std::string threadName{};
+				std::vector<ZoneEvent> events{};
+			};
+
+			std::atomic<bool> g_IsRecording{ false };
+			std::chrono::steady_clock::time_point g_StartTime{};
+
+			std::mutex g_RegistryMutex{};
+			std::vector<ThreadBuffer*> g_ThreadBuffers{};
+			// Buffers of threads that exited while recording
+			std::vector<ThreadBuffer> g_RetiredBuffers{};
+			uint32_t g_NextThreadId{ 1 };
+
+			// Lives as long as its thread, hands its zones over when the thread exits
+			struct ThreadBufferRegistration
+			{
+				ThreadBuffer buffer{};
+
+				ThreadBufferRegistration()
+				{
+					std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+					buffer.threadId = g_NextThreadId++;
+					g_ThreadBuffers.push_back(&buffer);
+				}
+
+				~ThreadBufferRegistration()
+				{
+					std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+					if (!buffer.events.empty()) g_RetiredBuffers.push_back(std::move(buffer));
+					g_ThreadBuffers.erase(std::find(g_ThreadBuffers.begin(), g_ThreadBuffers.end(), &buffer));
+				}
+			};
+
+			ThreadBuffer& GetThreadBuffer()
+			{
+				thread_local ThreadBufferRegistration registration{};
+				return registration.buffer;
+			}
+
+			void WriteThreadEvents(std::ofstream& file, const ThreadBuffer& buffer, bool& isFirstEvent)
+			{
+				const auto separator = [&]() -> const char*
+					{
+						const char* pSeparator{ isFirstEvent ? "\n" : ",\n" };
+						isFirstEvent = false;
+						return pSeparator;
+					};
+
+				const std::string threadName{ buffer.threadName.empty() ? "Thread " + std::to_string(buffer.threadId) : buffer.threadName };
+				file << separator() << R"({"ph":"M","name":"thread_name","pid":1,"tid":)" << buffer.threadId
+					<< R"(,"args":{"name":")" << threadName << R"("}})";
+
+				// Timestamps and durations in microseconds
+				for (const ZoneEvent& event : buffer.events)
+				{
+					file << separator() << R"({"ph":"X","name":")" << event.name << R"(","pid":1,"tid":)" << buffer.threadId
+						<< R"(,"ts":)" << event.startTime / 1000.0
+						<< R"(,"dur":)" << (event.endTime - event.startTime) / 1000.0;
+					if (event.argument >= 0) file << R"(,"args":{"index":)" << event.argument << '}';
+					file << '}';
+				}
+			}
+		}
+
+		void Start()
+		{
+			std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+			for (ThreadBuffer* pBuffer : g_ThreadBuffers) pBuffer->events.clear();
+			g_RetiredBuffers.clear();
+
+			g_StartTime = std::chrono::steady_clock::now();
+			g_IsRecording = true;
+		}
+
+		bool Stop(const std::string& filePath)
+		{
+			g_IsRecording = false;
+
+			std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+			std::ofstream file{ filePath };
+			if (!file) return false;
+
+			file << std::fixed << std::setprecision(3);
+			file << R"({"displayTimeUnit":"ms","traceEvents":[)";
+			bool isFirstEvent{ true };
+			for (const ThreadBuffer& buffer : g_RetiredBuffers)
+			{
+				WriteThreadEvents(file, buffer, isFirstEvent);
+			}
+			for (ThreadBuffer* pBuffer : g_ThreadBuffers)
+			{
+				WriteThreadEvents(file, *pBuffer, isFirstEvent);
+				pBuffer->events.clear();
+			}
+			g_RetiredBuffers.clear();
+			file << "\n]}\n";
+			return file.good();
+		}
+
+		bool IsRecording()
+		{
+			return g_IsRecording.load(std::memory_order_acquire);
+		}
+
+		void SetThreadName(const std::string& threadName)
+		{
+			ThreadBuffer& buffer{ GetThreadBuffer() };
+			std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+			buffer.threadName = threadName;
+		}
+
+		uint64_t GetTimestamp()
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_StartTime).count());
+		}
+
+		void RecordZone(const char* name, uint64_t startTime, uint64_t endTime, int64_t argument)
+		{
+			GetThreadBuffer().events.push_back({ name, startTime, endTime, argument });
+		}
+	}
+}
\ No newline at end of file
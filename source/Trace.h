@@ -0,0 +1,70 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Comment out to compile every TRACE_ZONE out, they cost one flag check while no trace is being recorded
+#define TRACE_ZONES
+
+namespace dae
+{
+	/**
+	 * \brief Timeline of named zones per thread, saved in the Chrome trace event format (chrome://tracing, ui.perfetto.dev)
+	 * Zones are recorded into a buffer of their own thread, so recording takes no locks
+	 */
+	namespace Trace
+	{
+		void Start();
+		/**
+		 * \brief Stops recording and writes every zone recorded since Start, returns false when the file could not be written
+		 * Only call while no other thread is inside a zone (between frames)
+		 */
+		bool Stop(const std::string& filePath);
+		bool IsRecording();
+
+		// Shown instead of the thread id, call once from the thread itself
+		void SetThreadName(const std::string& threadName);
+
+		uint64_t GetTimestamp();
+		void RecordZone(const char* name, uint64_t startTime, uint64_t endTime, int64_t argument);
+
+		// Records the time between its construction and destruction, name has to outlive the trace (a literal)
+		class Zone final
+		{
+		public:
+			explicit Zone(const char* name, int64_t argument = -1) :
+				m_Name{ IsRecording() ? name : nullptr },
+				m_Argument{ argument },
+				m_StartTime{ m_Name ? GetTimestamp() : 0 }
+			{
+			}
+
+			~Zone()
+			{
+				if (m_Name) RecordZone(m_Name, m_StartTime, GetTimestamp(), m_Argument);
+			}
+
+			Zone(const Zone&) = delete;
+			Zone(Zone&&) noexcept = delete;
+			Zone& operator=(const Zone&) = delete;
+			Zone& operator=(Zone&&) noexcept = delete;
+
+		private:
+			const char* m_Name;
+			int64_t m_Argument;
+			uint64_t m_StartTime;
+		};
+	}
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TRACE_ZONES
+#define TRACE_ZONE(name) ::dae::Trace::Zone TRACE_CONCAT(traceZone, __LINE__){ name }
+// The argument (a tile index, ...) shows up with the zone, -1 hides it
+#define TRACE_ZONE_ARG(name, argument) ::dae::Trace::Zone TRACE_CONCAT(traceZone, __LINE__){ name, static_cast<int64_t>(argument) }
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_ZONE_ARG(name, argument) ((void)0)
+#endif
\ No newline at end of file
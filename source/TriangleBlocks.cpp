@@ -0,0 +1,252 @@
+#include "TriangleBlocks.h"
+
+#include <cfloat>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	void TriangleBlockList::Build(const BVH& bvh, const std::vector<Vector3>& vertices, const std::vector<int>& indices, const std::vector<Vector3>& faceNormals)
+	{
+		Clear();
+		if (bvh.IsEmpty()) return;
+
+		nodeFirstBlock.resize(bvh.nodes.size());
+		blocks.reserve(bvh.primitiveIndices.size() / g_TriangleBlockSize + bvh.nodes.size() / 2 + 1);
+
+		for (size_t nodeIndex{ 0 }; nodeIndex < bvh.nodes.size(); ++nodeIndex)
+		{
+			const BVHNode& node{ bvh.nodes[nodeIndex] };
+			if (!node.IsLeaf()) continue;
+
+			nodeFirstBlock[nodeIndex] = static_cast<uint32_t>(blocks.size());
+			for (uint32_t first{ 0 }; first < node.primitiveCount; first += g_TriangleBlockSize)
+			{
+				TriangleBlock block{};
+				block.count = std::min(g_TriangleBlockSize, node.primitiveCount - first);
+				for (uint32_t lane{ 0 }; lane < block.count; ++lane)
+				{
+					const uint32_t triangleIndex{ bvh.primitiveIndices[node.leftFirst + first + lane] };
+					const size_t index{ static_cast<size_t>(triangleIndex) * 3 };
+
+					const Vector3& v0{ vertices[indices[index]] };
+					const Vector3 edge1{ vertices[indices[index + 1]] - v0 };
+					const Vector3 edge2{ vertices[indices[index + 2]] - v0 };
+					const Vector3& normal{ faceNormals[triangleIndex] };
+
+					block.v0x[lane] = v0.x;
+					block.v0y[lane] = v0.y;
+					block.v0z[lane] = v0.z;
+					block.edge1x[lane] = edge1.x;
+					block.edge1y[lane] = edge1.y;
+					block.edge1z[lane] = edge1.z;
+					block.edge2x[lane] = edge2.x;
+					block.edge2y[lane] = edge2.y;
+					block.edge2z[lane] = edge2.z;
+					block.normalx[lane] = normal.x;
+					block.normaly[lane] = normal.y;
+					block.normalz[lane] = normal.z;
+					block.triangleIndex[lane] = triangleIndex;
+				}
+				blocks.push_back(block);
+			}
+		}
+	}
+
+	void TriangleBlockList::Clear()
+	{
+		blocks.clear();
+		nodeFirstBlock.clear();
+	}
+
+	void TriangleRecordList::Build(const BVH& bvh, const std::vector<Vector3>& vertices, const std::vector<int>& indices, const std::vector<Vector3>& faceNormals)
+	{
+		records.resize(bvh.primitiveIndices.size());
+		for (size_t i{ 0 }; i < records.size(); ++i)
+		{
+			const uint32_t triangleIndex{ bvh.primitiveIndices[i] };
+			const size_t index{ static_cast<size_t>(triangleIndex) * 3 };
+
+			TriangleRecord& record{ records[i] };
+			record.v0 = vertices[indices[index]];
+			record.edge1 = vertices[indices[index + 1]] - record.v0;
+			record.edge2 = vertices[indices[index + 2]] - record.v0;
+			record.normal = faceNormals[triangleIndex];
+			record.triangleIndex = triangleIndex;
+		}
+	}
+
+	namespace TriangleBlockUtils
+	{
+		// Picks the closest valid lane, invalid lanes hold FLT_MAX
+		static int ClosestLane(const float laneT[g_TriangleBlockSize], float tMax, float& t)
+		{
+			int closestLane{ -1 };
+			float closestT{ tMax };
+			for (int lane{ 0 }; lane < static_cast<int>(g_TriangleBlockSize); ++lane)
+			{
+				if (laneT[lane] < closestT)
+				{
+					closestT = laneT[lane];
+					closestLane = lane;
+				}
+			}
+			if (closestLane != -1) t = closestT;
+			return closestLane;
+		}
+
+		static int IntersectTriangleBlock_Scalar(const TriangleBlock& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, TriangleCullMode cullMode, float& t)
+		{
+			float laneT[g_TriangleBlockSize];
+			for (uint32_t lane{ 0 }; lane < g_TriangleBlockSize; ++lane)
+			{
+				laneT[lane] = FLT_MAX;
+
+				const float normalDotDirection{ block.normalx[lane] * direction.x + block.normaly[lane] * direction.y + block.normalz[lane] * direction.z };
+				if (cullMode == TriangleCullMode::BackFaceCulling && normalDotDirection > 0) continue;
+				if (cullMode == TriangleCullMode::FrontFaceCulling && normalDotDirection < 0) continue;
+
+				const Vector3 edge1{ block.edge1x[lane], block.edge1y[lane], block.edge1z[lane] };
+				const Vector3 edge2{ block.edge2x[lane], block.edge2y[lane], block.edge2z[lane] };
+
+				const Vector3 h{ Vector3::Cross(direction, edge2) };
+				const float a{ Vector3::Dot(edge1, h) };
+				if (a > -FLT_EPSILON && a < FLT_EPSILON) continue; // This ray is parallel to this triangle.
+
+				const float f{ 1.f / a };
+				const Vector3 s{ origin.x - block.v0x[lane], origin.y - block.v0y[lane], origin.z - block.v0z[lane] };
+				const float u{ f * Vector3::Dot(s, h) };
+				if (u < 0.f || u > 1.f) continue;
+
+				const Vector3 q{ Vector3::Cross(s, edge1) };
+				const float v{ f * Vector3::Dot(direction, q) };
+				if (v < 0.f || u + v > 1.f) continue;
+
+				const float laneHitT{ f * Vector3::Dot(edge2, q) };
+				if (laneHitT > tMin && laneHitT < tMax)
+				{
+					laneT[lane] = laneHitT;
+				}
+			}
+			return ClosestLane(laneT, tMax, t);
+		}
+
+#if defined(SIMD_X86)
+		static int IntersectTriangleBlock_SSE(const TriangleBlock& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, TriangleCullMode cullMode, float& t)
+		{
+			const __m128 ox{ _mm_set1_ps(origin.x) }, oy{ _mm_set1_ps(origin.y) }, oz{ _mm_set1_ps(origin.z) };
+			const __m128 dx{ _mm_set1_ps(direction.x) }, dy{ _mm_set1_ps(direction.y) }, dz{ _mm_set1_ps(direction.z) };
+			const __m128 zero{ _mm_setzero_ps() }, one{ _mm_set1_ps(1.f) };
+			const __m128 epsilon{ _mm_set1_ps(FLT_EPSILON) }, minusEpsilon{ _mm_set1_ps(-FLT_EPSILON) };
+			const __m128 rayMin{ _mm_set1_ps(tMin) }, rayMax{ _mm_set1_ps(tMax) }, noHit{ _mm_set1_ps(FLT_MAX) };
+
+			alignas(16) float laneT[g_TriangleBlockSize];
+			for (uint32_t offset{ 0 }; offset < g_TriangleBlockSize; offset += 4)
+			{
+				const __m128 e1x{ _mm_load_ps(block.edge1x + offset) }, e1y{ _mm_load_ps(block.edge1y + offset) }, e1z{ _mm_load_ps(block.edge1z + offset) };
+				const __m128 e2x{ _mm_load_ps(block.edge2x + offset) }, e2y{ _mm_load_ps(block.edge2y + offset) }, e2z{ _mm_load_ps(block.edge2z + offset) };
+
+				// Rejection masks are built the same way as the scalar early-outs, so NaNs behave identically
+				__m128 rejected{ _mm_setzero_ps() };
+				if (cullMode != TriangleCullMode::NoCulling)
+				{
+					const __m128 nDotD{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(block.normalx + offset), dx), _mm_mul_ps(_mm_load_ps(block.normaly + offset), dy)), _mm_mul_ps(_mm_load_ps(block.normalz + offset), dz)) };
+					rejected = (cullMode == TriangleCullMode::BackFaceCulling) ? _mm_cmpgt_ps(nDotD, zero) : _mm_cmplt_ps(nDotD, zero);
+				}
+
+				// h = cross(direction, edge2)
+				const __m128 hx{ _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y)) };
+				const __m128 hy{ _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z)) };
+				const __m128 hz{ _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x)) };
+				const __m128 a{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz)) };
+				rejected = _mm_or_ps(rejected, _mm_and_ps(_mm_cmpgt_ps(a, minusEpsilon), _mm_cmplt_ps(a, epsilon)));
+
+				const __m128 f{ _mm_div_ps(one, a) };
+				const __m128 sx{ _mm_sub_ps(ox, _mm_load_ps(block.v0x + offset)) };
+				const __m128 sy{ _mm_sub_ps(oy, _mm_load_ps(block.v0y + offset)) };
+				const __m128 sz{ _mm_sub_ps(oz, _mm_load_ps(block.v0z + offset)) };
+				const __m128 u{ _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz))) };
+				rejected = _mm_or_ps(rejected, _mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmpgt_ps(u, one)));
+
+				// q = cross(s, edge1)
+				const __m128 qx{ _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y)) };
+				const __m128 qy{ _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z)) };
+				const __m128 qz{ _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x)) };
+				const __m128 v{ _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz))) };
+				rejected = _mm_or_ps(rejected, _mm_or_ps(_mm_cmplt_ps(v, zero), _mm_cmpgt_ps(_mm_add_ps(u, v), one)));
+
+				const __m128 hitT{ _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz))) };
+				const __m128 accepted{ _mm_andnot_ps(rejected, _mm_and_ps(_mm_cmpgt_ps(hitT, rayMin), _mm_cmplt_ps(hitT, rayMax))) };
+
+				_mm_store_ps(laneT + offset, _mm_or_ps(_mm_and_ps(accepted, hitT), _mm_andnot_ps(accepted, noHit)));
+			}
+			return ClosestLane(laneT, tMax, t);
+		}
+
+		SIMD_TARGET_AVX2
+		static int IntersectTriangleBlock_AVX2(const TriangleBlock& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, TriangleCullMode cullMode, float& t)
+		{
+			const __m256 ox{ _mm256_set1_ps(origin.x) }, oy{ _mm256_set1_ps(origin.y) }, oz{ _mm256_set1_ps(origin.z) };
+			const __m256 dx{ _mm256_set1_ps(direction.x) }, dy{ _mm256_set1_ps(direction.y) }, dz{ _mm256_set1_ps(direction.z) };
+			const __m256 zero{ _mm256_setzero_ps() }, one{ _mm256_set1_ps(1.f) };
+			const __m256 epsilon{ _mm256_set1_ps(FLT_EPSILON) }, minusEpsilon{ _mm256_set1_ps(-FLT_EPSILON) };
+
+			const __m256 e1x{ _mm256_load_ps(block.edge1x) }, e1y{ _mm256_load_ps(block.edge1y) }, e1z{ _mm256_load_ps(block.edge1z) };
+			const __m256 e2x{ _mm256_load_ps(block.edge2x) }, e2y{ _mm256_load_ps(block.edge2y) }, e2z{ _mm256_load_ps(block.edge2z) };
+
+			__m256 rejected{ _mm256_setzero_ps() };
+			if (cullMode != TriangleCullMode::NoCulling)
+			{
+				const __m256 nDotD{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(block.normalx), dx), _mm256_mul_ps(_mm256_load_ps(block.normaly), dy)), _mm256_mul_ps(_mm256_load_ps(block.normalz), dz)) };
+				rejected = (cullMode == TriangleCullMode::BackFaceCulling) ? _mm256_cmp_ps(nDotD, zero, _CMP_GT_OQ) : _mm256_cmp_ps(nDotD, zero, _CMP_LT_OQ);
+			}
+
+			const __m256 hx{ _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y)) };
+			const __m256 hy{ _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z)) };
+			const __m256 hz{ _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x)) };
+			const __m256 a{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)), _mm256_mul_ps(e1z, hz)) };
+			rejected = _mm256_or_ps(rejected, _mm256_and_ps(_mm256_cmp_ps(a, minusEpsilon, _CMP_GT_OQ), _mm256_cmp_ps(a, epsilon, _CMP_LT_OQ)));
+
+			const __m256 f{ _mm256_div_ps(one, a) };
+			const __m256 sx{ _mm256_sub_ps(ox, _mm256_load_ps(block.v0x)) };
+			const __m256 sy{ _mm256_sub_ps(oy, _mm256_load_ps(block.v0y)) };
+			const __m256 sz{ _mm256_sub_ps(oz, _mm256_load_ps(block.v0z)) };
+			const __m256 u{ _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)), _mm256_mul_ps(sz, hz))) };
+			rejected = _mm256_or_ps(rejected, _mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ), _mm256_cmp_ps(u, one, _CMP_GT_OQ)));
+
+			const __m256 qx{ _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y)) };
+			const __m256 qy{ _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z)) };
+			const __m256 qz{ _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x)) };
+			const __m256 v{ _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz))) };
+			rejected = _mm256_or_ps(rejected, _mm256_or_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_GT_OQ)));
+
+			const __m256 hitT{ _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz))) };
+			const __m256 accepted{ _mm256_andnot_ps(rejected, _mm256_and_ps(_mm256_cmp_ps(hitT, _mm256_set1_ps(tMin), _CMP_GT_OQ), _mm256_cmp_ps(hitT, _mm256_set1_ps(tMax), _CMP_LT_OQ))) };
+
+			alignas(32) float laneT[g_TriangleBlockSize];
+			_mm256_store_ps(laneT, _mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), hitT, accepted));
+			return ClosestLane(laneT, tMax, t);
+		}
+#endif
+
+		int IntersectTriangleBlock(const TriangleBlock& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, TriangleCullMode cullMode, float& t, SIMDLevel level)
+		{
+			switch (level)
+			{
+#if defined(SIMD_X86)
+			case SIMDLevel::AVX2:
+				return IntersectTriangleBlock_AVX2(block, origin, direction, tMin, tMax, cullMode, t);
+			case SIMDLevel::SSE:
+				return IntersectTriangleBlock_SSE(block, origin, direction, tMin, tMax, cullMode, t);
+#endif
+			default:
+				return IntersectTriangleBlock_Scalar(block, origin, direction, tMin, tMax, cullMode, t);
+			}
+		}
+
+		int IntersectTriangleBlock(const TriangleBlock& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, TriangleCullMode cullMode, float& t)
+		{
+			return IntersectTriangleBlock(block, origin, direction, tMin, tMax, cullMode, t, SIMD::GetSIMDLevel());
+		}
+	}
+}
\ No newline at end of file
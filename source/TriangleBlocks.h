@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "BVH.h"
+#include "SIMD.h"
+
+// Triangle intersection of the hit tests, the SIMD blocks only implement this one
+#define MOLLER_TRUMBORE
+// Mesh traversal tests whole SoA triangle blocks per BVH leaf instead of one triangle at a time
+#define SIMD_TRIANGLE_BLOCKS
+
+// Decides both which layout a mesh builds and which one the traversal reads, the scalar records cover every other case
+#if defined(SIMD_TRIANGLE_BLOCKS) && defined(MOLLER_TRUMBORE)
+#define USE_TRIANGLE_BLOCKS
+#endif
+
+namespace dae
+{
+	enum class TriangleCullMode;
+
+	constexpr uint32_t g_TriangleBlockSize{ 8 };
+
+	/**
+	 * \brief Up to 8 triangles in SoA layout with precomputed edges, so one ray is tested against all of them at once
+	 * Unused lanes hold degenerate triangles (zero edges), which never pass the parallel test
+	 */
+	struct alignas(32) TriangleBlock
+	{
+		float v0x[g_TriangleBlockSize]{}, v0y[g_TriangleBlockSize]{}, v0z[g_TriangleBlockSize]{};
+		float edge1x[g_TriangleBlockSize]{}, edge1y[g_TriangleBlockSize]{}, edge1z[g_TriangleBlockSize]{};
+		float edge2x[g_TriangleBlockSize]{}, edge2y[g_TriangleBlockSize]{}, edge2z[g_TriangleBlockSize]{};
+		float normalx[g_TriangleBlockSize]{}, normaly[g_TriangleBlockSize]{}, normalz[g_TriangleBlockSize]{};
+
+		uint32_t triangleIndex[g_TriangleBlockSize]{};
+		uint32_t count{};
+	};
+
+	/**
+	 * \brief The triangles of every BVH leaf packed into consecutive blocks
+	 */
+	struct TriangleBlockList
+	{
+		std::vector<TriangleBlock> blocks{};
+		// First block of every leaf, indexed by node (a leaf spans ceil(primitiveCount / g_TriangleBlockSize) blocks)
+		std::vector<uint32_t> nodeFirstBlock{};
+
+		void Build(const BVH& bvh, const std::vector<Vector3>& vertices, const std::vector<int>& indices, const std::vector<Vector3>& faceNormals);
+		void Clear();
+		bool IsEmpty() const { return blocks.empty(); }
+	};
+
+	/**
+	 * \brief One triangle with its Moller-Trumbore edges precomputed, a cache line per triangle
+	 * Used by the scalar traversal when the SIMD blocks are disabled
+	 */
+	struct alignas(64) TriangleRecord
+	{
+		Vector3 v0{};
+		Vector3 edge1{};
+		Vector3 edge2{};
+		Vector3 normal{};
+		uint32_t triangleIndex{};
+	};
+
+	/**
+	 * \brief The triangles of the BVH in leaf order, so a leaf reads the records at [leftFirst, leftFirst + primitiveCount)
+	 */
+	struct TriangleRecordList
+	{
+		std::vector<TriangleRecord> records{};
+
+		void Build(const BVH& bvh, const std::vector<Vector3>& vertices, const std::vector<int>& indices, const std::vector<Vector3>& faceNormals);
+		void Clear() { records.clear(); }
+		bool IsEmpty() const { return records.empty(); }
+	};
+
+	namespace TriangleBlockUtils
+	{
+		/**
+		 * \brief Moller-Trumbore against every triangle of the block, using the widest kernel the CPU supports
+		 * \param cullMode Cull mode to apply (already flipped for shadow rays)
+		 * \param t Distance of the closest hit in (tMin, tMax), only written on a hit
+		 * \return Lane of the closest hit, -1 when nothing was hit
+		 */
+		int IntersectTriangleBlock(const TriangleBlock& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, TriangleCullMode cullMode, float& t);
+
+		// Same, with a forced kernel
+		int IntersectTriangleBlock(const TriangleBlock& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, TriangleCullMode cullMode, float& t, SIMDLevel level);
+	}
+}
\ No newline at end of file
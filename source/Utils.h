@@ -1,19 +1,34 @@
 #pragma once
 #include <cassert>
-#include <fstream>
+#include <type_traits>
 #include "Math.h"
 #include "DataTypes.h"
-
-#define MOLLER_TRUMBORE
+#include "OBJLoader.h"
+#include "RayPacket.h"
+#include "Statistics.h"
 
 namespace dae
 {
 	namespace GeometryUtils
 	{
+		/**
+		 * \brief What a hit test has to find out, picked at compile time so the any-hit kernels carry no closest-hit work
+		 * Closest shrinks the ray to every hit and fills the hit record of the nearest one
+		 * Any stops at the first hit in (ray.min, ray.max) and never touches a hit record (shadow rays)
+		 */
+		enum class HitQuery
+		{
+			Closest,
+			Any
+		};
+
 #pragma region Sphere HitTest
 		//SPHERE HIT-TESTS
-		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		// Distance to the near side of the sphere, or to the far side when the near one lies before ray.min
+		inline bool Intersect_Sphere(const Sphere& sphere, const Ray& ray, float& t)
 		{
+			STATS_INCREMENT(PrimitiveTests);
+
 			Vector3 vectorDiff = ray.origin - sphere.origin;
 
 			float A{ Vector3::Dot(ray.direction,ray.direction) };
@@ -23,64 +38,78 @@ namespace dae
 			float D{ (B * B) - (4 * A * C) };
 			if (D <= 0) // No hit
 			{
-				hitRecord.didHit = false;
 				return false;
 			}
-			else if (D > 0) // 2 hits
+
+			// 2 hits
+			t = ((- B - sqrtf(D)) / (2 * A));
+			if (t < ray.min)
+			{
+				t = ((- B + sqrtf(D)) / (2 * A));
+			}
+			return t > ray.min && t < ray.max;
+		}
+
+		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord)
+		{
+			float t{};
+			if (!Intersect_Sphere(sphere, ray, t))
 			{
-				float t{ ((- B - sqrtf(D)) / (2 * A))};
-				if (t < ray.min)
-				{
-					t = ((- B + sqrtf(D)) / (2 * A));
-				}
-				if (t > ray.min && t < ray.max)
-				{
-					hitRecord.didHit = true;
-					hitRecord.materialIndex = sphere.materialIndex;
-					hitRecord.origin = ray.origin + (t * ray.direction);
-					hitRecord.normal = (hitRecord.origin - sphere.origin).Normalized();
-					hitRecord.t = t;
-					return true;
-				}
 				hitRecord.didHit = false;
+				return false;
 			}
-			return false;
+
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = sphere.materialIndex;
+			hitRecord.origin = ray.origin + (t * ray.direction);
+			hitRecord.normal = (hitRecord.origin - sphere.origin).Normalized();
+			hitRecord.t = t;
+			return true;
 		}
 
-		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
+		inline bool DoesHit_Sphere(const Sphere& sphere, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Sphere(sphere, ray, temp, true);
+			float t{};
+			return Intersect_Sphere(sphere, ray, t);
 		}
 #pragma endregion
 #pragma region Plane HitTest
 		//PLANE HIT-TESTS
-		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool Intersect_Plane(const Plane& plane, const Ray& ray, float& t)
 		{
-			const float t = Vector3::Dot((plane.origin - ray.origin), plane.normal) / Vector3::Dot(ray.direction,plane.normal);
-			if (t > ray.min && t < ray.max)
+			STATS_INCREMENT(PrimitiveTests);
+
+			t = Vector3::Dot((plane.origin - ray.origin), plane.normal) / Vector3::Dot(ray.direction,plane.normal);
+			return t > ray.min && t < ray.max;
+		}
+
+		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord)
+		{
+			float t{};
+			if (!Intersect_Plane(plane, ray, t))
 			{
-				hitRecord.origin = (ray.origin + ray.direction * t);
-				hitRecord.normal = plane.normal;
-				hitRecord.materialIndex = plane.materialIndex;
-				hitRecord.t = t;
-				hitRecord.didHit = true;
-				return true;
+				hitRecord.didHit = false;
+				return false;
 			}
-			hitRecord.didHit = false;
-			return false;
+
+			hitRecord.origin = (ray.origin + ray.direction * t);
+			hitRecord.normal = plane.normal;
+			hitRecord.materialIndex = plane.materialIndex;
+			hitRecord.t = t;
+			hitRecord.didHit = true;
+			return true;
 		}
 
-		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
+		inline bool DoesHit_Plane(const Plane& plane, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Plane(plane, ray, temp, true);
+			float t{};
+			return Intersect_Plane(plane, ray, t);
 		}
 #pragma endregion
 #pragma region Triangle HitTest
 		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
-			const Vector3 inversedDirection = { 1.f / ray.direction.x,1.f / ray.direction.y,1.f / ray.direction.z };
+			const Vector3& inversedDirection{ ray.inversedDirection };
 			const float tx1 = (mesh.transformedMinAABB.x - ray.origin.x) * inversedDirection.x;
 			const float tx2 = (mesh.transformedMaxAABB.x - ray.origin.x) * inversedDirection.x;
 
@@ -103,45 +132,77 @@ namespace dae
 		}
 
 		//TRIANGLE HIT-TESTS
-		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		// Shadow rays (any-hit) travel towards the light, so they see the other side of the triangle
+		template<HitQuery query>
+		constexpr TriangleCullMode GetEffectiveCullMode(TriangleCullMode cullMode)
 		{
-			TriangleCullMode cullMode{ triangle.cullMode };
-			if (ignoreHitRecord)
+			if constexpr (query == HitQuery::Any)
 			{
-				switch (triangle.cullMode)
+				switch (cullMode)
 				{
 				case TriangleCullMode::BackFaceCulling:
-					cullMode = TriangleCullMode::FrontFaceCulling;
-					break;
+					return TriangleCullMode::FrontFaceCulling;
 				case TriangleCullMode::FrontFaceCulling:
-					cullMode = TriangleCullMode::BackFaceCulling;
-					break;
+					return TriangleCullMode::BackFaceCulling;
+				case TriangleCullMode::NoCulling:
+					return TriangleCullMode::NoCulling;
 				}
 			}
+			return cullMode;
+		}
+
+		template<TriangleCullMode cullMode>
+		using CullModeConstant = std::integral_constant<TriangleCullMode, cullMode>;
+
+		/**
+		 * \brief Turns a cull mode known at runtime into a compile time one, once per mesh or triangle instead of once per test
+		 * \param function Called with a CullModeConstant, read the mode back with decltype(constant)::value
+		 */
+		template<typename Function>
+		inline decltype(auto) DispatchCullMode(TriangleCullMode cullMode, Function&& function)
+		{
 			switch (cullMode)
 			{
+			case TriangleCullMode::FrontFaceCulling:
+				return function(CullModeConstant<TriangleCullMode::FrontFaceCulling>{});
 			case TriangleCullMode::BackFaceCulling:
+				return function(CullModeConstant<TriangleCullMode::BackFaceCulling>{});
+			default:
+				return function(CullModeConstant<TriangleCullMode::NoCulling>{});
+			}
+		}
+
+		/**
+		 * \brief Distance to the triangle along the ray, when it lies in (ray.min, ray.max)
+		 * \param triangle Precomputed edges, the normal is only used for culling
+		 */
+		template<TriangleCullMode cullMode>
+		inline bool Intersect_Triangle(const TriangleRecord& triangle, const Ray& ray, float& t)
+		{
+			STATS_INCREMENT(PrimitiveTests);
+
+			if constexpr (cullMode == TriangleCullMode::BackFaceCulling)
+			{
 				if (Vector3::Dot(triangle.normal, ray.direction) > 0)
 				{
 					return false;
 				}
-				break;
-			case TriangleCullMode::FrontFaceCulling:
+			}
+			else if constexpr (cullMode == TriangleCullMode::FrontFaceCulling)
+			{
 				if (Vector3::Dot(triangle.normal, ray.direction) < 0)
 				{
 					return false;
 				}
-				break;
-			case TriangleCullMode::NoCulling:
-				break;
 			}
+
+			const Vector3& edge1{ triangle.edge1 };
+			const Vector3& edge2{ triangle.edge2 };
 #ifdef MOLLER_TRUMBORE
 			// Source: https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
 
-			Vector3 edge1, edge2, h, s, q;
+			Vector3 h, s, q;
 			float a, f, u, v;
-			edge1 = triangle.v1 - triangle.v0;
-			edge2 = triangle.v2 - triangle.v0;
 			h = Vector3::Cross(ray.direction, edge2);
 			a = Vector3::Dot(edge1, h);
 			if (a > -FLT_EPSILON && a < FLT_EPSILON)
@@ -156,103 +217,768 @@ namespace dae
 			if (v < 0.0 || u + v > 1.0)
 				return false;
 			// At this stage we can compute t to find out where the intersection point is on the line.
-			float t = f * Vector3::Dot(edge2, q);
-			if (t > ray.min && t < ray.max) // ray intersection
-			{
-				hitRecord.origin = ray.origin + ray.direction * t;
-				hitRecord.didHit = true;
-				hitRecord.materialIndex = triangle.materialIndex;
-				hitRecord.normal = triangle.normal;
-				hitRecord.t = t;
-				return true;
-			}
-			else // This means that there is a line intersection but not a ray intersection.
-				return false;
+			t = f * Vector3::Dot(edge2, q);
+			// Outside the range there is a line intersection but not a ray intersection.
+			return t > ray.min && t < ray.max;
 #else // No Moller Trumbore
-			Vector3 center = ((triangle.v0 + triangle.v1 + triangle.v2) / 3);
-			Vector3 a{ triangle.v1 - triangle.v0 };
-			Vector3 b{ triangle.v2 - triangle.v0 };
-			Vector3 normal = Vector3::Cross(a, b);
-			if (Vector3::Dot(normal, ray.direction) == 0)
+			Vector3 center = triangle.v0 + (edge1 + edge2) / 3;
+			Vector3 faceNormal = Vector3::Cross(edge1, edge2);
+			if (Vector3::Dot(faceNormal, ray.direction) == 0)
 				return false;
 			Vector3 L{ center - ray.origin };
-			float t = Vector3::Dot(L, normal) / Vector3::Dot(ray.direction, normal);
+			t = Vector3::Dot(L, faceNormal) / Vector3::Dot(ray.direction, faceNormal);
 			if (t < ray.min || t > ray.max)
 				return false;
 			Vector3 p = ray.origin + t * ray.direction;
 
-			Vector3 c{ p - triangle.v0 };
-
-			Vector3 edgeA{ triangle.v1 - triangle.v0 };
-			Vector3 edgeB{ triangle.v2 - triangle.v1 };
-			Vector3 edgeC{ triangle.v0 - triangle.v2 };
+			// Edges v0 > v1, v1 > v2 and v2 > v0, each point has to lie on the inner side of all three
 			Vector3 pointToSide{ p - triangle.v0 };
-			if (Vector3::Dot(normal, Vector3::Cross(edgeA, pointToSide)) < 0)
+			if (Vector3::Dot(faceNormal, Vector3::Cross(edge1, pointToSide)) < 0)
 				return false;
-			pointToSide = p - triangle.v1;
-			if (Vector3::Dot(normal, Vector3::Cross(edgeB, pointToSide)) < 0)
+			pointToSide -= edge1;
+			if (Vector3::Dot(faceNormal, Vector3::Cross(edge2 - edge1, pointToSide)) < 0)
 				return false;
-			pointToSide = p - triangle.v2;
-			if (Vector3::Dot(normal, Vector3::Cross(edgeC, pointToSide)) < 0)
+			pointToSide = p - triangle.v0 - edge2;
+			if (Vector3::Dot(faceNormal, Vector3::Cross(-edge2, pointToSide)) < 0)
 				return false;
-			
-			//Fill in HitRecord
+			return true;
+#endif
+		}
+
+		// Same for a triangle given by its corners, the edges are computed on the spot
+		template<TriangleCullMode cullMode>
+		inline bool Intersect_Triangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Vector3& normal, const Ray& ray, float& t)
+		{
+			TriangleRecord triangle;
+			triangle.v0 = v0;
+			triangle.edge1 = v1 - v0;
+			triangle.edge2 = v2 - v0;
+			triangle.normal = normal;
+			return Intersect_Triangle<cullMode>(triangle, ray, t);
+		}
+
+		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord)
+		{
+			float t{};
+			const bool didHit{ DispatchCullMode(triangle.cullMode, [&](auto cullModeConstant)
+				{
+					return Intersect_Triangle<decltype(cullModeConstant)::value>(triangle.v0, triangle.v1, triangle.v2, triangle.normal, ray, t);
+				}) };
+			if (!didHit) return false;
+
+			hitRecord.origin = ray.origin + ray.direction * t;
 			hitRecord.didHit = true;
 			hitRecord.materialIndex = triangle.materialIndex;
 			hitRecord.normal = triangle.normal;
 			hitRecord.t = t;
-			hitRecord.origin = p;
 			return true;
-#endif
 		}
 
-		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray)
+		inline bool DoesHit_Triangle(const Triangle& triangle, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Triangle(triangle, ray, temp, true);
+			float t{};
+			return DispatchCullMode(GetEffectiveCullMode<HitQuery::Any>(triangle.cullMode), [&](auto cullModeConstant)
+				{
+					return Intersect_Triangle<decltype(cullModeConstant)::value>(triangle.v0, triangle.v1, triangle.v2, triangle.normal, ray, t);
+				});
 		}
 #pragma endregion
 #pragma region TriangeMesh HitTest
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray, float& tEntry)
 		{
-			if (mesh.indices.size() % 3) return false;
+			const Vector3& inversedDirection{ ray.inversedDirection };
+			const float tx1 = (minAABB.x - ray.origin.x) * inversedDirection.x;
+			const float tx2 = (maxAABB.x - ray.origin.x) * inversedDirection.x;
 
-			// Slabtest
-			if (!SlabTest_TriangleMesh(mesh, ray))
+			float tmin = std::min(tx1, tx2);
+			float tmax = std::max(tx1, tx2);
+
+			const float ty1 = (minAABB.y - ray.origin.y) * inversedDirection.y;
+			const float ty2 = (maxAABB.y - ray.origin.y) * inversedDirection.y;
+
+			tmin = std::max(tmin, std::min(ty1, ty2));
+			tmax = std::min(tmax, std::max(ty1, ty2));
+
+			const float tz1 = (minAABB.z - ray.origin.z) * inversedDirection.z;
+			const float tz2 = (maxAABB.z - ray.origin.z) * inversedDirection.z;
+
+			tmin = std::max(tmin, std::min(tz1, tz2));
+			tmax = std::min(tmax, std::max(tz1, tz2));
+
+			tEntry = tmin;
+			return tmax >= tmin && tmax > ray.min && tmin < ray.max;
+		}
+
+		/**
+		 * \brief Walks a BVH nearest-child first, calling hitLeaf for every leaf the ray reaches
+		 * \param ray Ray to traverse with, the leaf callback may shrink ray.max to cull farther nodes
+		 * \param hitLeaf bool(uint32_t nodeIndex, Ray& ray), returning true stops the traversal
+		 * \return True when the traversal was stopped by the callback
+		 */
+		template<typename LeafFunction>
+		inline bool TraverseBVHLeaves(const BVH& bvh, Ray& ray, LeafFunction&& hitLeaf)
+		{
+			if (bvh.IsEmpty()) return false;
+
+			const std::vector<BVHNode>& nodes{ bvh.nodes };
+			uint32_t nodeStack[g_BVHStackSize];
+			int stackSize{ 0 };
+			nodeStack[stackSize++] = 0; // Callers test the root bounds themselves
+			while (stackSize > 0)
 			{
-				return false;
+				const uint32_t nodeIndex{ nodeStack[--stackSize] };
+				const BVHNode& node{ nodes[nodeIndex] };
+				STATS_INCREMENT(NodeVisits);
+				if (node.IsLeaf())
+				{
+					if (hitLeaf(nodeIndex, ray))
+					{
+						return true;
+					}
+					continue;
+				}
+
+				// Visit the nearest child first, the far one is pushed underneath it
+				float tLeft{}, tRight{};
+				const bool hitLeft{ SlabTest_AABB(nodes[node.leftFirst].minAABB, nodes[node.leftFirst].maxAABB, ray, tLeft) };
+				const bool hitRight{ SlabTest_AABB(nodes[node.leftFirst + 1].minAABB, nodes[node.leftFirst + 1].maxAABB, ray, tRight) };
+				// The build limits the depth to fit the stack
+				assert(stackSize + 2 <= static_cast<int>(g_BVHStackSize));
+				if (hitLeft && hitRight)
+				{
+					const bool leftIsNear{ tLeft <= tRight };
+					nodeStack[stackSize++] = leftIsNear ? node.leftFirst + 1 : node.leftFirst;
+					nodeStack[stackSize++] = leftIsNear ? node.leftFirst : node.leftFirst + 1;
+				}
+				else if (hitLeft)
+				{
+					nodeStack[stackSize++] = node.leftFirst;
+				}
+				else if (hitRight)
+				{
+					nodeStack[stackSize++] = node.leftFirst + 1;
+				}
 			}
-			HitRecord smallestTRecord;
-			smallestTRecord.t = FLT_MAX;
-			HitRecord currentRecord;
-			bool hitAtleastOne{ false };
-			size_t amountOfTriangles{ mesh.indices.size() / 3 };
-			Triangle triangle;
-			for (size_t i{ 0 }; i < amountOfTriangles; ++i)
+			return false;
+		}
+
+		/**
+		 * \brief Walks a wide BVH nearest-child first, testing all children of a node in one SIMD slab test
+		 * \param ray Ray to traverse with, the leaf callback may shrink ray.max to cull farther nodes
+		 * \param hitLeaf bool(uint32_t nodeIndex, Ray& ray) with the index of the leaf in the binary BVH, returning true stops the traversal
+		 * \return True when the traversal was stopped by the callback
+		 */
+		template<typename LeafFunction>
+		inline bool TraverseWideBVHLeaves(const WideBVH& wideBVH, Ray& ray, LeafFunction&& hitLeaf)
+		{
+			if (wideBVH.IsEmpty()) return false;
+
+			struct StackEntry
 			{
-				const size_t index{ (i * 3) };
+				uint32_t node;
+				float tEntry;
+			};
+			constexpr uint32_t leafFlag{ 0x80000000u };
 
-				triangle = { mesh.transformedPositions[mesh.indices[index]], mesh.transformedPositions[mesh.indices[index + 1]], mesh.transformedPositions[mesh.indices[index + 2]] };
-				triangle.cullMode = mesh.cullMode; 
-				triangle.materialIndex = mesh.materialIndex;
-				triangle.normal = mesh.transformedNormals[i];
-				if (HitTest_Triangle(triangle, ray, currentRecord, ignoreHitRecord))
+			const WideBVHUtils::WideRay wideRay{ WideBVHUtils::MakeWideRay(ray.origin, ray.inversedDirection) };
+			StackEntry nodeStack[g_WideBVHStackSize];
+			int stackSize{ 0 };
+			nodeStack[stackSize++] = { 0, -FLT_MAX }; // Callers test the root bounds themselves
+			while (stackSize > 0)
+			{
+				const StackEntry entry{ nodeStack[--stackSize] };
+				// A hit found since this entry was pushed may already be closer
+				if (entry.tEntry >= ray.max) continue;
+				STATS_INCREMENT(NodeVisits);
+
+				if (entry.node & leafFlag)
+				{
+					if (hitLeaf(entry.node & ~leafFlag, ray))
+					{
+						return true;
+					}
+					continue;
+				}
+
+				const WideBVHNode& node{ wideBVH.nodes[entry.node] };
+				float tEntry[g_WideBVHWidth];
+				const uint32_t hitMask{ WideBVHUtils::IntersectWideNode(node, wideRay, ray.min, ray.max, tEntry) };
+
+				// Insert the hit children sorted far to near, so the nearest one is popped first
+				const int firstPushed{ stackSize };
+				for (uint32_t lane{ 0 }; lane < node.childCount; ++lane)
+				{
+					if (!(hitMask & (1u << lane))) continue;
+
+					const StackEntry child{ node.IsLeaf(lane) ? node.child[lane] | leafFlag : node.child[lane], tEntry[lane] };
+					assert(stackSize < static_cast<int>(g_WideBVHStackSize));
+					int i{ stackSize++ };
+					while (i > firstPushed && nodeStack[i - 1].tEntry < child.tEntry)
+					{
+						nodeStack[i] = nodeStack[i - 1];
+						--i;
+					}
+					nodeStack[i] = child;
+				}
+			}
+			return false;
+		}
+
+		// Walks the wide BVH when it is enabled and built, the binary one otherwise
+		template<typename LeafFunction>
+		inline bool TraverseBVHLeaves(const BVH& bvh, const WideBVH& wideBVH, Ray& ray, LeafFunction&& hitLeaf)
+		{
+#ifdef WIDE_BVH
+			if (!wideBVH.IsEmpty())
+			{
+				return TraverseWideBVHLeaves(wideBVH, ray, hitLeaf);
+			}
+#endif
+			return TraverseBVHLeaves(bvh, ray, hitLeaf);
+		}
+
+		/**
+		 * \brief Walks a BVH nearest-child first, calling hitLeafPrimitive for every primitive in a leaf the ray reaches
+		 * \param ray Ray to traverse with, the leaf callback may shrink ray.max to cull farther nodes
+		 * \param hitLeafPrimitive bool(uint32_t primitiveIndex, Ray& ray), returning true stops the traversal
+		 * \return True when the traversal was stopped by the callback
+		 */
+		template<typename LeafFunction>
+		inline bool TraverseBVH(const BVH& bvh, const WideBVH& wideBVH, Ray& ray, LeafFunction&& hitLeafPrimitive)
+		{
+			return TraverseBVHLeaves(bvh, wideBVH, ray, [&](uint32_t nodeIndex, Ray& currentRay)
 				{
-					if (currentRecord.t < smallestTRecord.t)
+					const BVHNode& node{ bvh.nodes[nodeIndex] };
+					for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
 					{
-						smallestTRecord = currentRecord;
+						if (hitLeafPrimitive(bvh.primitiveIndices[node.leftFirst + i], currentRay))
+						{
+							return true;
+						}
 					}
+					return false;
+				});
+		}
+
+		/**
+		 * \brief Walks a binary BVH with a whole packet, keeping the index of the first ray that still hits the current node
+		 * Nodes outside the packet frustum are skipped without testing a single ray
+		 * \param firstActive Rays before this one are ignored
+		 * \param hitLeaf bool(uint32_t nodeIndex, RayPacket& packet, uint32_t firstActive), only rays from firstActive on can hit the leaf, returning true stops the traversal
+		 * \return True when the traversal was stopped by the callback
+		 */
+		template<typename LeafFunction>
+		inline bool TraversePacketBVHLeaves(const BVH& bvh, RayPacket& packet, uint32_t firstActive, LeafFunction&& hitLeaf)
+		{
+			if (bvh.IsEmpty()) return false;
+
+			struct StackEntry
+			{
+				uint32_t node;
+				uint32_t firstActive;
+			};
+
+			const std::vector<BVHNode>& nodes{ bvh.nodes };
+			StackEntry nodeStack[g_BVHStackSize];
+			int stackSize{ 0 };
+			nodeStack[stackSize++] = { 0, firstActive };
+			while (stackSize > 0)
+			{
+				const StackEntry entry{ nodeStack[--stackSize] };
+				const BVHNode& node{ nodes[entry.node] };
+				STATS_INCREMENT(NodeVisits);
+				if (packet.frustum.isValid && packet.frustum.ExcludesAABB(node.minAABB, node.maxAABB)) continue;
+
+				// Rays before the first one that hits are skipped for the whole subtree
+				uint32_t firstHit{ entry.firstActive };
+				float tEntry{};
+				while (firstHit < packet.count && !SlabTest_AABB(node.minAABB, node.maxAABB, packet.rays[firstHit], tEntry))
+				{
+					++firstHit;
+				}
+				if (firstHit == packet.count) continue;
+
+				if (node.IsLeaf())
+				{
+					if (hitLeaf(entry.node, packet, firstHit))
+					{
+						return true;
+					}
+					continue;
+				}
+
+				// Nearest child first for the first active ray, the rest of the packet is coherent enough to agree
+				const Ray& firstRay{ packet.rays[firstHit] };
+				const BVHNode& leftChild{ nodes[node.leftFirst] };
+				const bool leftIsNear{ Vector3::Dot((leftChild.minAABB + leftChild.maxAABB) - (node.minAABB + node.maxAABB), firstRay.direction) <= 0.f };
+				assert(stackSize + 2 <= static_cast<int>(g_BVHStackSize));
+				nodeStack[stackSize++] = { leftIsNear ? node.leftFirst + 1 : node.leftFirst, firstHit };
+				nodeStack[stackSize++] = { leftIsNear ? node.leftFirst : node.leftFirst + 1, firstHit };
+			}
+			return false;
+		}
+
+		// Takes a ray whose answer is final (an occluded shadow ray) out of the packet, it no longer passes any slab test
+		inline void RetireRay(Ray& ray)
+		{
+			ray.max = -FLT_MAX;
+		}
+
+		/**
+		 * \brief Hit test against the triangles of one BVH leaf
+		 * Closest shrinks ray.max to every hit, Any returns at the first hit without touching the ray
+		 * \param cullMode Cull mode to apply, already flipped for shadow rays
+		 * \param closestTriangleIndex Triangle that was hit, only written on a closest hit
+		 */
+		template<HitQuery query, TriangleCullMode cullMode>
+		inline bool HitTest_TriangleMeshLeaf(const TriangleMesh& mesh, const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals, uint32_t nodeIndex, Ray& ray, uint32_t& closestTriangleIndex)
+		{
+			const BVHNode& node{ mesh.bvh.nodes[nodeIndex] };
+			bool hitAtleastOne{ false };
+
+#ifdef USE_TRIANGLE_BLOCKS
+			if (!mesh.triangleBlocks.IsEmpty())
+			{
+				STATS_ADD(PrimitiveTests, node.primitiveCount);
+				const uint32_t firstBlock{ mesh.triangleBlocks.nodeFirstBlock[nodeIndex] };
+				const uint32_t lastBlock{ firstBlock + (node.primitiveCount + g_TriangleBlockSize - 1) / g_TriangleBlockSize };
+				for (uint32_t blockIndex{ firstBlock }; blockIndex < lastBlock; ++blockIndex)
+				{
+					const TriangleBlock& block{ mesh.triangleBlocks.blocks[blockIndex] };
+					float t{};
+					const int lane{ TriangleBlockUtils::IntersectTriangleBlock(block, ray.origin, ray.direction, ray.min, ray.max, cullMode, t) };
+					if (lane == -1) continue;
+
+					if constexpr (query == HitQuery::Any) return true;
+					closestTriangleIndex = block.triangleIndex[lane];
+					ray.max = t;
 					hitAtleastOne = true;
 				}
+				return hitAtleastOne;
+			}
+#else
+			if (!mesh.triangleRecords.IsEmpty())
+			{
+				// The records of a leaf are contiguous, in the order of the primitive indices
+				const TriangleRecord* pRecords{ mesh.triangleRecords.records.data() + node.leftFirst };
+				for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+				{
+					float t{};
+					if (!Intersect_Triangle<cullMode>(pRecords[i], ray, t)) continue;
+
+					if constexpr (query == HitQuery::Any) return true;
+					closestTriangleIndex = pRecords[i].triangleIndex;
+					ray.max = t;
+					hitAtleastOne = true;
+				}
+				return hitAtleastOne;
+			}
+#endif
+
+			// Meshes without blocks or records, e.g. read from a cache that was written with the other layout
+			for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+			{
+				const uint32_t triangleIndex{ mesh.bvh.primitiveIndices[node.leftFirst + i] };
+				const size_t index{ (static_cast<size_t>(triangleIndex) * 3) };
+
+				float t{};
+				if (!Intersect_Triangle<cullMode>(vertices[mesh.indices[index]], vertices[mesh.indices[index + 1]], vertices[mesh.indices[index + 2]], faceNormals[triangleIndex], ray, t)) continue;
+
+				if constexpr (query == HitQuery::Any) return true;
+				closestTriangleIndex = triangleIndex;
+				ray.max = t;
+				hitAtleastOne = true;
 			}
-			hitRecord = smallestTRecord;
 			return hitAtleastOne;
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		/**
+		 * \brief Walks the mesh BVH with the cull mode of the mesh resolved once up front
+		 * \param ray Shrunk to the closest hit for Closest, stops the walk at the first hit for Any
+		 * \param closestTriangleIndex Triangle of the closest hit, only written for Closest
+		 */
+		template<HitQuery query>
+		inline bool Trace_TriangleMeshGeometry(const TriangleMesh& mesh, const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals, Ray& ray, uint32_t& closestTriangleIndex)
 		{
-			HitRecord temp{};
-			return HitTest_TriangleMesh(mesh, ray, temp, true);
+			return DispatchCullMode(GetEffectiveCullMode<query>(mesh.cullMode), [&](auto cullModeConstant)
+				{
+					bool hitAtleastOne{ false };
+					TraverseBVHLeaves(mesh.bvh, mesh.wideBVH, ray, [&](uint32_t nodeIndex, Ray& currentRay)
+						{
+							const bool hitLeaf{ HitTest_TriangleMeshLeaf<query, decltype(cullModeConstant)::value>(mesh, vertices, faceNormals, nodeIndex, currentRay, closestTriangleIndex) };
+							hitAtleastOne |= hitLeaf;
+							return query == HitQuery::Any && hitLeaf;
+						});
+					return hitAtleastOne;
+				});
+		}
+
+		/**
+		 * \brief Intersects the mesh triangles as stored, the ray has to be in the same space as the vertices
+		 * \param vertices Either the object space positions or the transformed positions of the mesh
+		 * \param faceNormals Normals matching the space of the vertices
+		 */
+		inline bool HitTest_TriangleMeshGeometry(const TriangleMesh& mesh, const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals, unsigned char materialIndex, const Ray& ray, HitRecord& hitRecord)
+		{
+			// Shrink the ray to the closest hit so far, so farther triangles and nodes get culled
+			Ray closestRay{ ray };
+			uint32_t closestTriangleIndex{};
+			const bool hitAtleastOne{ Trace_TriangleMeshGeometry<HitQuery::Closest>(mesh, vertices, faceNormals, closestRay, closestTriangleIndex) };
+
+			hitRecord = HitRecord{};
+			hitRecord.t = FLT_MAX;
+			if (hitAtleastOne)
+			{
+				hitRecord.origin = ray.origin + ray.direction * closestRay.max;
+				hitRecord.didHit = true;
+				hitRecord.materialIndex = materialIndex;
+				hitRecord.normal = faceNormals[closestTriangleIndex];
+				hitRecord.t = closestRay.max;
+			}
+			return hitAtleastOne;
+		}
+
+		// Any-hit version, stops at the first triangle between ray.min and ray.max
+		inline bool DoesHit_TriangleMeshGeometry(const TriangleMesh& mesh, const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals, const Ray& ray)
+		{
+			Ray shadowRay{ ray };
+			uint32_t triangleIndex{};
+			return Trace_TriangleMeshGeometry<HitQuery::Any>(mesh, vertices, faceNormals, shadowRay, triangleIndex);
+		}
+
+		/**
+		 * \brief Splits the packet up into single rays when too few of its rays reach the bounds of an object
+		 * \param traceRay void(uint32_t rayIndex), called for every ray from firstActive on that reaches the bounds
+		 * \return True when the rays were traced one by one, false when the packet is dense enough to trace together
+		 */
+		template<typename RayFunction>
+		inline bool TraceSparsePacket(const Vector3& minAABB, const Vector3& maxAABB, const RayPacket& packet, uint32_t firstActive, RayFunction&& traceRay)
+		{
+			bool reachesBounds[g_PacketSize]{};
+			uint32_t nrActiveRays{};
+			float tEntry{};
+			for (uint32_t r{ firstActive }; r < packet.count; ++r)
+			{
+				reachesBounds[r] = SlabTest_AABB(minAABB, maxAABB, packet.rays[r], tEntry);
+				nrActiveRays += reachesBounds[r];
+			}
+			if (nrActiveRays >= g_PacketMinActiveRays) return false;
+
+			for (uint32_t r{ firstActive }; r < packet.count; ++r)
+			{
+				if (reachesBounds[r]) traceRay(r);
+			}
+			return true;
+		}
+
+
+		/**
+		 * \brief Walks the mesh with every ray of the packet from firstActive on, calling onHit for every ray that hits a leaf triangle closer than its ray.max
+		 * \param onHit bool(uint32_t rayIndex, uint32_t triangleIndex), returning true retires the ray from the packet (the triangle index is only valid for Closest)
+		 */
+		template<HitQuery query, typename HitFunction>
+		inline void TracePacket_TriangleMeshGeometry(const TriangleMesh& mesh, const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals, RayPacket& packet, uint32_t firstActive, HitFunction&& onHit)
+		{
+			const BVHNode& root{ mesh.bvh.nodes[0] };
+			uint32_t nrActiveRays{};
+			float tEntry{};
+			for (uint32_t r{ firstActive }; r < packet.count; ++r)
+			{
+				nrActiveRays += SlabTest_AABB(root.minAABB, root.maxAABB, packet.rays[r], tEntry);
+			}
+
+			DispatchCullMode(GetEffectiveCullMode<query>(mesh.cullMode), [&](auto cullModeConstant)
+				{
+					uint32_t nrRetiredRays{};
+					TraversePacketBVHLeaves(mesh.bvh, packet, firstActive, [&](uint32_t nodeIndex, RayPacket& currentPacket, uint32_t firstLeafRay)
+						{
+							const BVHNode& leaf{ mesh.bvh.nodes[nodeIndex] };
+							for (uint32_t r{ firstLeafRay }; r < currentPacket.count; ++r)
+							{
+								Ray& ray{ currentPacket.rays[r] };
+								if (!SlabTest_AABB(leaf.minAABB, leaf.maxAABB, ray, tEntry)) continue;
+
+								uint32_t triangleIndex{};
+								if (HitTest_TriangleMeshLeaf<query, decltype(cullModeConstant)::value>(mesh, vertices, faceNormals, nodeIndex, ray, triangleIndex) && onHit(r, triangleIndex))
+								{
+									RetireRay(ray);
+									++nrRetiredRays;
+								}
+							}
+							// Nothing left to trace once every ray that reached the mesh is done
+							return nrRetiredRays == nrActiveRays;
+						});
+				});
+		}
+
+		/**
+		 * \brief Packet version, rays from firstActive on that hit a triangle closer than their ray.max get their record and ray.max updated
+		 */
+		inline void HitTest_TriangleMeshGeometry(const TriangleMesh& mesh, const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals, unsigned char materialIndex, RayPacket& packet, uint32_t firstActive, HitRecord* hitRecords)
+		{
+			uint32_t closestTriangleIndices[g_PacketSize];
+			bool didHit[g_PacketSize]{};
+			TracePacket_TriangleMeshGeometry<HitQuery::Closest>(mesh, vertices, faceNormals, packet, firstActive, [&](uint32_t rayIndex, uint32_t triangleIndex)
+				{
+					closestTriangleIndices[rayIndex] = triangleIndex;
+					didHit[rayIndex] = true;
+					return false;
+				});
+
+			for (uint32_t r{ firstActive }; r < packet.count; ++r)
+			{
+				if (!didHit[r]) continue;
+
+				const Ray& ray{ packet.rays[r] };
+				HitRecord& hitRecord{ hitRecords[r] };
+				hitRecord.origin = ray.origin + ray.direction * ray.max;
+				hitRecord.didHit = true;
+				hitRecord.materialIndex = materialIndex;
+				hitRecord.normal = faceNormals[closestTriangleIndices[r]];
+				hitRecord.t = ray.max;
+			}
+		}
+
+		/**
+		 * \brief Packet any-hit, rays from firstActive on that hit a triangle get flagged and retired from the packet
+		 */
+		inline void DoesHit_TriangleMeshGeometry(const TriangleMesh& mesh, const std::vector<Vector3>& vertices, const std::vector<Vector3>& faceNormals, RayPacket& packet, uint32_t firstActive, bool* occluded)
+		{
+			TracePacket_TriangleMeshGeometry<HitQuery::Any>(mesh, vertices, faceNormals, packet, firstActive, [&](uint32_t rayIndex, uint32_t)
+				{
+					occluded[rayIndex] = true;
+					return true;
+				});
+		}
+
+		/**
+		 * \brief Moves the ray into the object space of the mesh, intersects it there and moves the hit back to world space
+		 * \param worldToObject Inverse of the placement transform
+		 * \param normalToWorld Inverse transpose of the placement transform
+		 */
+		inline bool HitTest_TriangleMeshObjectSpace(const TriangleMesh& mesh, const Matrix& worldToObject, const Matrix& normalToWorld, unsigned char materialIndex, const Ray& ray, HitRecord& hitRecord)
+		{
+			// Direction is not renormalized, so t is the same in both spaces
+			const Ray objectRay{ worldToObject.TransformPoint(ray.origin), worldToObject.TransformVector(ray.direction), ray.min, ray.max };
+
+			if (!HitTest_TriangleMeshGeometry(mesh, mesh.positions, mesh.normals, materialIndex, objectRay, hitRecord))
+			{
+				return false;
+			}
+
+			hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
+			hitRecord.normal = normalToWorld.TransformVector(hitRecord.normal).Normalized();
+			return true;
+		}
+
+		// Any-hit version, nothing has to go back to world space
+		inline bool DoesHit_TriangleMeshObjectSpace(const TriangleMesh& mesh, const Matrix& worldToObject, const Ray& ray)
+		{
+			const Ray objectRay{ worldToObject.TransformPoint(ray.origin), worldToObject.TransformVector(ray.direction), ray.min, ray.max };
+			return DoesHit_TriangleMeshGeometry(mesh, mesh.positions, mesh.normals, objectRay);
+		}
+
+		// Moves the packet rays from firstActive on into object space, the corner rays are transformed along so the frustum still bounds the packet
+		inline void TransformPacket(const RayPacket& packet, uint32_t firstActive, const Matrix& worldToObject, RayPacket& objectPacket)
+		{
+			objectPacket.count = packet.count;
+			for (uint32_t r{ firstActive }; r < packet.count; ++r)
+			{
+				const Ray& ray{ packet.rays[r] };
+				objectPacket.rays[r] = Ray{ worldToObject.TransformPoint(ray.origin), worldToObject.TransformVector(ray.direction), ray.min, ray.max };
+			}
+			for (int i{ 0 }; i < 4; ++i)
+			{
+				objectPacket.cornerDirections[i] = worldToObject.TransformVector(packet.cornerDirections[i]);
+			}
+			objectPacket.frustum.isValid = packet.frustum.isValid;
+			if (objectPacket.frustum.isValid)
+			{
+				objectPacket.frustum.Build(worldToObject.TransformPoint(packet.frustum.origin), objectPacket.cornerDirections);
+			}
+		}
+
+		// Packet version of the closest hit in object space
+		inline void HitTest_TriangleMeshObjectSpace(const TriangleMesh& mesh, const Matrix& worldToObject, const Matrix& normalToWorld, unsigned char materialIndex, RayPacket& packet, uint32_t firstActive, HitRecord* hitRecords)
+		{
+			RayPacket objectPacket;
+			TransformPacket(packet, firstActive, worldToObject, objectPacket);
+
+			HitRecord objectHitRecords[g_PacketSize];
+			HitTest_TriangleMeshGeometry(mesh, mesh.positions, mesh.normals, materialIndex, objectPacket, firstActive, objectHitRecords);
+
+			for (uint32_t r{ firstActive }; r < packet.count; ++r)
+			{
+				const HitRecord& objectHitRecord{ objectHitRecords[r] };
+				if (!objectHitRecord.didHit) continue;
+
+				Ray& ray{ packet.rays[r] };
+				HitRecord& hitRecord{ hitRecords[r] };
+				hitRecord = objectHitRecord;
+				hitRecord.origin = ray.origin + ray.direction * objectHitRecord.t;
+				hitRecord.normal = normalToWorld.TransformVector(objectHitRecord.normal).Normalized();
+				ray.max = objectHitRecord.t;
+			}
+		}
+
+		// Packet version of the any-hit in object space
+		inline void DoesHit_TriangleMeshObjectSpace(const TriangleMesh& mesh, const Matrix& worldToObject, RayPacket& packet, uint32_t firstActive, bool* occluded)
+		{
+			RayPacket objectPacket;
+			TransformPacket(packet, firstActive, worldToObject, objectPacket);
+
+			DoesHit_TriangleMeshGeometry(mesh, mesh.positions, mesh.normals, objectPacket, firstActive, occluded);
+
+			for (uint32_t r{ firstActive }; r < packet.count; ++r)
+			{
+				if (occluded[r]) RetireRay(packet.rays[r]);
+			}
+		}
+
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return false;
+
+			// Slabtest
+			if (!SlabTest_TriangleMesh(mesh, ray))
+			{
+				return false;
+			}
+
+			if (mesh.transformMode == MeshTransformMode::WorldSpace)
+			{
+				return HitTest_TriangleMeshGeometry(mesh, mesh.transformedPositions, mesh.transformedNormals, mesh.materialIndex, ray, hitRecord);
+			}
+			return HitTest_TriangleMeshObjectSpace(mesh, mesh.worldToObject, mesh.normalToWorld, mesh.materialIndex, ray, hitRecord);
+		}
+
+		inline bool DoesHit_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return false;
+
+			// Slabtest
+			if (!SlabTest_TriangleMesh(mesh, ray))
+			{
+				return false;
+			}
+
+			if (mesh.transformMode == MeshTransformMode::WorldSpace)
+			{
+				return DoesHit_TriangleMeshGeometry(mesh, mesh.transformedPositions, mesh.transformedNormals, ray);
+			}
+			return DoesHit_TriangleMeshObjectSpace(mesh, mesh.worldToObject, ray);
+		}
+
+		// Packet version of the closest hit, see HitTest_TriangleMeshGeometry
+		inline void HitTest_TriangleMesh(const TriangleMesh& mesh, RayPacket& packet, uint32_t firstActive, HitRecord* hitRecords)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return;
+
+			const bool tracedSparse{ TraceSparsePacket(mesh.transformedMinAABB, mesh.transformedMaxAABB, packet, firstActive, [&](uint32_t rayIndex)
+				{
+					HitRecord hitRecord{};
+					if (HitTest_TriangleMesh(mesh, packet.rays[rayIndex], hitRecord))
+					{
+						hitRecords[rayIndex] = hitRecord;
+						packet.rays[rayIndex].max = hitRecord.t;
+					}
+				}) };
+			if (tracedSparse) return;
+
+			if (mesh.transformMode == MeshTransformMode::WorldSpace)
+			{
+				HitTest_TriangleMeshGeometry(mesh, mesh.transformedPositions, mesh.transformedNormals, mesh.materialIndex, packet, firstActive, hitRecords);
+				return;
+			}
+			HitTest_TriangleMeshObjectSpace(mesh, mesh.worldToObject, mesh.normalToWorld, mesh.materialIndex, packet, firstActive, hitRecords);
+		}
+
+		// Packet version of the any-hit, see DoesHit_TriangleMeshGeometry
+		inline void DoesHit_TriangleMesh(const TriangleMesh& mesh, RayPacket& packet, uint32_t firstActive, bool* occluded)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return;
+
+			const bool tracedSparse{ TraceSparsePacket(mesh.transformedMinAABB, mesh.transformedMaxAABB, packet, firstActive, [&](uint32_t rayIndex)
+				{
+					if (DoesHit_TriangleMesh(mesh, packet.rays[rayIndex]))
+					{
+						occluded[rayIndex] = true;
+						RetireRay(packet.rays[rayIndex]);
+					}
+				}) };
+			if (tracedSparse) return;
+
+			if (mesh.transformMode == MeshTransformMode::WorldSpace)
+			{
+				DoesHit_TriangleMeshGeometry(mesh, mesh.transformedPositions, mesh.transformedNormals, packet, firstActive, occluded);
+				return;
+			}
+			DoesHit_TriangleMeshObjectSpace(mesh, mesh.worldToObject, packet, firstActive, occluded);
+		}
+
+		inline bool HitTest_MeshInstance(const MeshInstance& instance, const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return false;
+
+			// Slabtest
+			float tEntry{};
+			if (!SlabTest_AABB(instance.transformedMinAABB, instance.transformedMaxAABB, ray, tEntry))
+			{
+				return false;
+			}
+
+			return HitTest_TriangleMeshObjectSpace(mesh, instance.worldToObject, instance.normalToWorld, instance.materialIndex, ray, hitRecord);
+		}
+
+		inline bool DoesHit_MeshInstance(const MeshInstance& instance, const TriangleMesh& mesh, const Ray& ray)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return false;
+
+			// Slabtest
+			float tEntry{};
+			if (!SlabTest_AABB(instance.transformedMinAABB, instance.transformedMaxAABB, ray, tEntry))
+			{
+				return false;
+			}
+
+			return DoesHit_TriangleMeshObjectSpace(mesh, instance.worldToObject, ray);
+		}
+
+		// Packet version of the closest hit, see HitTest_TriangleMeshGeometry
+		inline void HitTest_MeshInstance(const MeshInstance& instance, const TriangleMesh& mesh, RayPacket& packet, uint32_t firstActive, HitRecord* hitRecords)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return;
+
+			const bool tracedSparse{ TraceSparsePacket(instance.transformedMinAABB, instance.transformedMaxAABB, packet, firstActive, [&](uint32_t rayIndex)
+				{
+					HitRecord hitRecord{};
+					if (HitTest_TriangleMeshObjectSpace(mesh, instance.worldToObject, instance.normalToWorld, instance.materialIndex, packet.rays[rayIndex], hitRecord))
+					{
+						hitRecords[rayIndex] = hitRecord;
+						packet.rays[rayIndex].max = hitRecord.t;
+					}
+				}) };
+			if (tracedSparse) return;
+
+			HitTest_TriangleMeshObjectSpace(mesh, instance.worldToObject, instance.normalToWorld, instance.materialIndex, packet, firstActive, hitRecords);
+		}
+
+		// Packet version of the any-hit, see DoesHit_TriangleMeshGeometry
+		inline void DoesHit_MeshInstance(const MeshInstance& instance, const TriangleMesh& mesh, RayPacket& packet, uint32_t firstActive, bool* occluded)
+		{
+			if (mesh.indices.size() % 3 || mesh.bvh.IsEmpty()) return;
+
+			const bool tracedSparse{ TraceSparsePacket(instance.transformedMinAABB, instance.transformedMaxAABB, packet, firstActive, [&](uint32_t rayIndex)
+				{
+					if (DoesHit_TriangleMeshObjectSpace(mesh, instance.worldToObject, packet.rays[rayIndex]))
+					{
+						occluded[rayIndex] = true;
+						RetireRay(packet.rays[rayIndex]);
+					}
+				}) };
+			if (tracedSparse) return;
+
+			DoesHit_TriangleMeshObjectSpace(mesh, instance.worldToObject, packet, firstActive, occluded);
 		}
 #pragma endregion
 	}
@@ -289,48 +1015,19 @@ namespace dae
 
 	namespace Utils
 	{
-		//Just parses vertices and indices
+		//Just parses vertices and indices, every face triangulated
 #pragma warning(push)
 #pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		// Counts and parses the file in chunks on the pool when one is given, never pass the pool of a Dispatch this runs in
+		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, ThreadPool* pThreadPool = nullptr)
 		{
-			std::ifstream file(filename);
-			if (!file)
+			OBJMesh mesh{};
+			if (!OBJLoader::Load(filename, mesh, pThreadPool))
 				return false;
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
-
-				if (file.eof()) 
-					break;
-			}
+			positions = std::move(mesh.positions);
+			indices = std::move(mesh.positionIndices);
+			normals.reserve(normals.size() + indices.size() / 3);
 
 			//Precompute normals
 			for (uint64_t index = 0; index < indices.size(); index += 3)
@@ -343,13 +1040,13 @@ namespace dae
 				Vector3 edgeV0V2 = positions[i2] - positions[i0];
 				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
 
-				if(isnan(normal.x))
+				if(std::isnan(normal.x))
 				{
 					int k = 0;
 				}
 
 				normal.Normalize();
-				if (isnan(normal.x))
+				if (std::isnan(normal.x))
 				{
 					int k = 0;
 				}
@@ -1,7 +1,13 @@
 #pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "SIMD.h"
 
 namespace dae
 {
+	// Everything is defined inline so the intersection and shading loops compile to straight-line code without LTO
 	struct Vector4;
 	struct Vector3
 	{
@@ -10,42 +16,173 @@ namespace dae
 		float z{};
 
 		Vector3() = default;
-		Vector3(float _x, float _y, float _z);
-		Vector3(const Vector3& from, const Vector3& to);
-		Vector3(const Vector4& v);
+		constexpr Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+		constexpr Vector3(const Vector3& from, const Vector3& to) : x(to.x - from.x), y(to.y - from.y), z(to.z - from.z) {}
+		// Defined in Vector4.h, together with ToPoint4 and ToVector4
+		constexpr Vector3(const Vector4& v);
+
+		float Magnitude() const
+		{
+#ifdef SIMD_X86
+			//https ://geometrian.com/programming/tutorials/fastsqrt/index.php
+			return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ps1(x * x + y * y + z * z)));
+#else
+			return sqrtf(x * x + y * y + z * z);
+#endif
+		}
+
+		constexpr float SqrMagnitude() const
+		{
+			return x * x + y * y + z * z;
+		}
+
+		float Normalize()
+		{
+			const float m = Magnitude();
+			x /= m;
+			y /= m;
+			z /= m;
+
+			return m;
+		}
+
+		Vector3 Normalized() const
+		{
+			const float m = Magnitude();
+			return { x / m, y / m, z / m };
+		}
+
+		static constexpr float Dot(const Vector3& v1, const Vector3& v2)
+		{
+			return ((v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z));
+		}
 
-		float Magnitude() const;
-		float SqrMagnitude() const;
-		float Normalize();
-		Vector3 Normalized() const;
+		static constexpr float DotClamp(const Vector3& v1, const Vector3& v2)
+		{
+			return { std::max(0.0f, Vector3::Dot(v1, v2)) };
+		}
 
-		static float Dot(const Vector3& v1, const Vector3& v2);
-		static float DotClamp(const Vector3& v1, const Vector3& v2);
-		static Vector3 Cross(const Vector3& v1, const Vector3& v2);
-		static Vector3 Project(const Vector3& v1, const Vector3& v2);
-		static Vector3 Reject(const Vector3& v1, const Vector3& v2);
-		static Vector3 Reflect(const Vector3& v1, const Vector3& v2);
-		static Vector3 Lico(float f1, const Vector3& v1, float f2, const Vector3& v2, float f3, const Vector3& v3);
+		static constexpr Vector3 Cross(const Vector3& v1, const Vector3& v2)
+		{
+			return Vector3{ (v1.y * v2.z) - (v1.z * v2.y), -((v1.x * v2.z) - (v1.z * v2.x)), (v1.x * v2.y) - (v1.y * v2.x) };
+		}
 
-		static Vector3 Max(const Vector3& v1, const Vector3& v2);
-		static Vector3 Min(const Vector3& v1, const Vector3& v2);
+		static constexpr Vector3 Project(const Vector3& v1, const Vector3& v2)
+		{
+			return (v2 * (Dot(v1, v2) / Dot(v2, v2)));
+		}
 
-		Vector4 ToPoint4() const;
-		Vector4 ToVector4() const;
+		static constexpr Vector3 Reject(const Vector3& v1, const Vector3& v2)
+		{
+			return (v1 - v2 * (Dot(v1, v2) / Dot(v2, v2)));
+		}
+
+		static constexpr Vector3 Reflect(const Vector3& v1, const Vector3& v2)
+		{
+			return v1 - v2 * (2.f * Vector3::Dot(v1, v2));
+		}
+
+		static constexpr Vector3 Lico(float f1, const Vector3& v1, float f2, const Vector3& v2, float f3, const Vector3& v3)
+		{
+			return v1 * f1 + v2 * f2 + v3 * f3;
+		}
+
+		static constexpr Vector3 Max(const Vector3& v1, const Vector3& v2)
+		{
+			return {
+				std::max(v1.x, v2.x),
+				std::max(v1.y, v2.y),
+				std::max(v1.z, v2.z)
+			};
+		}
+
+		static constexpr Vector3 Min(const Vector3& v1, const Vector3& v2)
+		{
+			return {
+				std::min(v1.x, v2.x),
+				std::min(v1.y, v2.y),
+				std::min(v1.z, v2.z)
+			};
+		}
+
+		constexpr Vector4 ToPoint4() const;
+		constexpr Vector4 ToVector4() const;
 
 		//Member Operators
-		Vector3 operator*(float scale) const;
-		Vector3 operator/(float scale) const;
-		Vector3 operator+(const Vector3& v) const;
-		Vector3 operator-(const Vector3& v) const;
-		Vector3 operator-() const;
-		//Vector3& operator-();
-		Vector3& operator+=(const Vector3& v);
-		Vector3& operator-=(const Vector3& v);
-		Vector3& operator/=(float scale);
-		Vector3& operator*=(float scale);
-		float& operator[](int index);
-		float operator[](int index) const;
+		constexpr Vector3 operator*(float scale) const
+		{
+			return { x * scale, y * scale, z * scale };
+		}
+
+		constexpr Vector3 operator/(float scale) const
+		{
+			return { x / scale, y / scale, z / scale };
+		}
+
+		constexpr Vector3 operator+(const Vector3& v) const
+		{
+			return { x + v.x, y + v.y, z + v.z };
+		}
+
+		constexpr Vector3 operator-(const Vector3& v) const
+		{
+			return { x - v.x, y - v.y, z - v.z };
+		}
+
+		constexpr Vector3 operator-() const
+		{
+			return { -x, -y, -z };
+		}
+
+		constexpr Vector3& operator+=(const Vector3& v)
+		{
+			x += v.x;
+			y += v.y;
+			z += v.z;
+			return *this;
+		}
+
+		constexpr Vector3& operator-=(const Vector3& v)
+		{
+			x -= v.x;
+			y -= v.y;
+			z -= v.z;
+			return *this;
+		}
+
+		constexpr Vector3& operator/=(float scale)
+		{
+			x /= scale;
+			y /= scale;
+			z /= scale;
+			return *this;
+		}
+
+		constexpr Vector3& operator*=(float scale)
+		{
+			x *= scale;
+			y *= scale;
+			z *= scale;
+			return *this;
+		}
+
+		constexpr float& operator[](int index)
+		{
+			assert(index <= 2 && index >= 0);
+
+			if (index == 0) return x;
+			if (index == 1) return y;
+			return z;
+		}
+
+		constexpr float operator[](int index) const
+		{
+			assert(index <= 2 && index >= 0);
+
+			if (index == 0) return x;
+			if (index == 1) return y;
+			return z;
+		}
 
 		static const Vector3 UnitX;
 		static const Vector3 UnitY;
@@ -53,9 +190,17 @@ namespace dae
 		static const Vector3 Zero;
 	};
 
+	inline constexpr Vector3 Vector3::UnitX{ 1, 0, 0 };
+	inline constexpr Vector3 Vector3::UnitY{ 0, 1, 0 };
+	inline constexpr Vector3 Vector3::UnitZ{ 0, 0, 1 };
+	inline constexpr Vector3 Vector3::Zero{ 0, 0, 0 };
+
 	//Global Operators
-	inline Vector3 operator*(float scale, const Vector3& v)
+	constexpr Vector3 operator*(float scale, const Vector3& v)
 	{
 		return { v.x * scale, v.y * scale, v.z * scale };
 	}
 }
+
+// The Vector4 conversions need the complete type
+#include "Vector4.h"
\ No newline at end of file
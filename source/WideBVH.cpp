@@ -0,0 +1,99 @@
+#include "WideBVH.h"
+
+#include <cfloat>
+
+namespace dae
+{
+	void WideBVH::Build(const BVH& bvh)
+	{
+		Clear();
+		if (bvh.IsEmpty()) return;
+
+		nodes.reserve(bvh.nodes.size() / 2 + 1);
+		Collapse(bvh, 0);
+	}
+
+	void WideBVH::Refit(const BVH& bvh)
+	{
+		for (WideBVHNode& node : nodes)
+		{
+			for (uint32_t lane{ 0 }; lane < node.childCount; ++lane)
+			{
+				CopyLaneBounds(node, lane, bvh.nodes[node.sourceNode[lane]]);
+			}
+		}
+	}
+
+	void WideBVH::Clear()
+	{
+		nodes.clear();
+	}
+
+	uint32_t WideBVH::Collapse(const BVH& bvh, uint32_t binaryNodeIndex)
+	{
+		// Open up the largest interior node until there are 4 candidates or only leaves are left
+		uint32_t candidates[g_WideBVHWidth]{ binaryNodeIndex };
+		uint32_t nrCandidates{ 1 };
+		while (nrCandidates < g_WideBVHWidth)
+		{
+			int largestCandidate{ -1 };
+			float largestArea{ -FLT_MAX };
+			for (uint32_t i{ 0 }; i < nrCandidates; ++i)
+			{
+				const BVHNode& candidate{ bvh.nodes[candidates[i]] };
+				if (candidate.IsLeaf()) continue;
+
+				const float area{ SurfaceArea(candidate.minAABB, candidate.maxAABB) };
+				if (area > largestArea)
+				{
+					largestArea = area;
+					largestCandidate = static_cast<int>(i);
+				}
+			}
+			if (largestCandidate == -1) break;
+
+			const uint32_t leftChild{ bvh.nodes[candidates[largestCandidate]].leftFirst };
+			candidates[largestCandidate] = leftChild;
+			candidates[nrCandidates++] = leftChild + 1;
+		}
+
+		const uint32_t wideNodeIndex{ static_cast<uint32_t>(nodes.size()) };
+		nodes.emplace_back();
+		{
+			WideBVHNode& node{ nodes[wideNodeIndex] };
+			node.childCount = nrCandidates;
+			node.leafMask = 0;
+			for (uint32_t lane{ 0 }; lane < g_WideBVHWidth; ++lane)
+			{
+				node.minX[lane] = node.minY[lane] = node.minZ[lane] = FLT_MAX;
+				node.maxX[lane] = node.maxY[lane] = node.maxZ[lane] = -FLT_MAX;
+				node.child[lane] = 0;
+				node.sourceNode[lane] = 0;
+			}
+		}
+
+		for (uint32_t lane{ 0 }; lane < nrCandidates; ++lane)
+		{
+			const BVHNode& binaryNode{ bvh.nodes[candidates[lane]] };
+			// Collapsing the child grows the vector, so the node is looked up again afterwards
+			const uint32_t child{ binaryNode.IsLeaf() ? candidates[lane] : Collapse(bvh, candidates[lane]) };
+
+			WideBVHNode& node{ nodes[wideNodeIndex] };
+			CopyLaneBounds(node, lane, binaryNode);
+			node.child[lane] = child;
+			node.sourceNode[lane] = candidates[lane];
+			if (binaryNode.IsLeaf()) node.leafMask |= 1u << lane;
+		}
+		return wideNodeIndex;
+	}
+
+	void WideBVH::CopyLaneBounds(WideBVHNode& node, uint32_t lane, const BVHNode& binaryNode) const
+	{
+		node.minX[lane] = binaryNode.minAABB.x;
+		node.minY[lane] = binaryNode.minAABB.y;
+		node.minZ[lane] = binaryNode.minAABB.z;
+		node.maxX[lane] = binaryNode.maxAABB.x;
+		node.maxY[lane] = binaryNode.maxAABB.y;
+		node.maxZ[lane] = binaryNode.maxAABB.z;
+	}
+}
\ No newline at end of file
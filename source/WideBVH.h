@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "BVH.h"
+#include "SIMD.h"
+
+// Traverse meshes and the scene through the 4-wide collapsed BVH instead of the binary one
+#define WIDE_BVH
+
+namespace dae
+{
+	constexpr uint32_t g_WideBVHWidth{ 4 };
+
+	/**
+	 * \brief Up to 4 child boxes in SoA layout, so a ray is slab tested against all of them at once
+	 * Unused lanes hold an inverted box (min = FLT_MAX, max = -FLT_MAX) that never passes the slab test
+	 */
+	struct alignas(16) WideBVHNode
+	{
+		float minX[g_WideBVHWidth], minY[g_WideBVHWidth], minZ[g_WideBVHWidth];
+		float maxX[g_WideBVHWidth], maxY[g_WideBVHWidth], maxZ[g_WideBVHWidth];
+
+		// Interior lane >> index of the child in WideBVH::nodes
+		// Leaf lane >> index of the leaf in the binary BVH, so per-leaf data (primitives, triangle blocks) is shared
+		uint32_t child[g_WideBVHWidth];
+		// Binary BVH node every lane was collapsed from, refits copy the bounds from there
+		uint32_t sourceNode[g_WideBVHWidth];
+		uint32_t childCount;
+		// Bit per lane that is a leaf
+		uint32_t leafMask;
+
+		bool IsLeaf(uint32_t lane) const { return (leafMask >> lane) & 1; }
+	};
+
+	/**
+	 * \brief QBVH collapsed from a binary BVH: every node keeps the 4 largest descendants of a binary subtree
+	 * Halves the depth, so a ray visits fewer nodes and loads its boxes as one contiguous node
+	 */
+	struct WideBVH
+	{
+		std::vector<WideBVHNode> nodes{};
+
+		void Build(const BVH& bvh);
+		// Copies the bounds of a refitted binary BVH, the topology of both has to be unchanged since Build
+		void Refit(const BVH& bvh);
+
+		void Clear();
+		bool IsEmpty() const { return nodes.empty(); }
+
+	private:
+		uint32_t Collapse(const BVH& bvh, uint32_t binaryNodeIndex);
+		void CopyLaneBounds(WideBVHNode& node, uint32_t lane, const BVHNode& binaryNode) const;
+	};
+
+	namespace WideBVHUtils
+	{
+		// Ray values broadcast once per traversal instead of once per node
+		struct WideRay
+		{
+#if defined(SIMD_X86)
+			__m128 originX, originY, originZ;
+			__m128 inversedDirectionX, inversedDirectionY, inversedDirectionZ;
+#else
+			Vector3 origin;
+			Vector3 inversedDirection;
+#endif
+		};
+
+		inline WideRay MakeWideRay(const Vector3& origin, const Vector3& inversedDirection)
+		{
+#if defined(SIMD_X86)
+			return WideRay{ _mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z),
+				_mm_set1_ps(inversedDirection.x), _mm_set1_ps(inversedDirection.y), _mm_set1_ps(inversedDirection.z) };
+#else
+			return WideRay{ origin, inversedDirection };
+#endif
+		}
+
+		/**
+		 * \brief Slab test of the ray against every lane of the node, with the same min/max ordering as GeometryUtils::SlabTest_AABB
+		 * \param tEntry Entry distance of every lane
+		 * \return Bit per lane whose box is hit within (tMin, tMax)
+		 */
+		inline uint32_t IntersectWideNode(const WideBVHNode& node, const WideRay& ray, float tMin, float tMax, float tEntry[g_WideBVHWidth])
+		{
+#if defined(SIMD_X86)
+			// _mm_min_ps(b, a) matches std::min(a, b) when a NaN shows up, so both paths agree on edge-on boxes
+			const __m128 tx1{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ray.originX), ray.inversedDirectionX) };
+			const __m128 tx2{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ray.originX), ray.inversedDirectionX) };
+			__m128 tmin{ _mm_min_ps(tx2, tx1) };
+			__m128 tmax{ _mm_max_ps(tx2, tx1) };
+
+			const __m128 ty1{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), ray.originY), ray.inversedDirectionY) };
+			const __m128 ty2{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), ray.originY), ray.inversedDirectionY) };
+			tmin = _mm_max_ps(_mm_min_ps(ty2, ty1), tmin);
+			tmax = _mm_min_ps(_mm_max_ps(ty2, ty1), tmax);
+
+			const __m128 tz1{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), ray.originZ), ray.inversedDirectionZ) };
+			const __m128 tz2{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), ray.originZ), ray.inversedDirectionZ) };
+			tmin = _mm_max_ps(_mm_min_ps(tz2, tz1), tmin);
+			tmax = _mm_min_ps(_mm_max_ps(tz2, tz1), tmax);
+
+			_mm_storeu_ps(tEntry, tmin);
+			const __m128 hit{ _mm_and_ps(_mm_cmpge_ps(tmax, tmin), _mm_and_ps(_mm_cmpgt_ps(tmax, _mm_set1_ps(tMin)), _mm_cmplt_ps(tmin, _mm_set1_ps(tMax)))) };
+			return static_cast<uint32_t>(_mm_movemask_ps(hit));
+#else
+			uint32_t hitMask{};
+			for (uint32_t lane{ 0 }; lane < g_WideBVHWidth; ++lane)
+			{
+				const float tx1 = (node.minX[lane] - ray.origin.x) * ray.inversedDirection.x;
+				const float tx2 = (node.maxX[lane] - ray.origin.x) * ray.inversedDirection.x;
+				float tmin = std::min(tx1, tx2);
+				float tmax = std::max(tx1, tx2);
+
+				const float ty1 = (node.minY[lane] - ray.origin.y) * ray.inversedDirection.y;
+				const float ty2 = (node.maxY[lane] - ray.origin.y) * ray.inversedDirection.y;
+				tmin = std::max(tmin, std::min(ty1, ty2));
+				tmax = std::min(tmax, std::max(ty1, ty2));
+
+				const float tz1 = (node.minZ[lane] - ray.origin.z) * ray.inversedDirection.z;
+				const float tz2 = (node.maxZ[lane] - ray.origin.z) * ray.inversedDirection.z;
+				tmin = std::max(tmin, std::min(tz1, tz2));
+				tmax = std::min(tmax, std::max(tz1, tz2));
+
+				tEntry[lane] = tmin;
+				if (tmax >= tmin && tmax > tMin && tmin < tMax) hitMask |= 1u << lane;
+			}
+			return hitMask;
+#endif
+		}
+	}
+}
\ No newline at end of file
@@ -1,64 +1,347 @@
 //External includes
+#if defined(_MSC_VER)
 #include "vld.h"
+#endif
+// HEADLESS_ONLY builds without SDL, leaving only --headless and --benchmark
+#if !defined(HEADLESS_ONLY)
 #include "SDL.h"
 #include "SDL_surface.h"
 #undef main
+#endif
 
 //Standard includes
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <vector>
 
 //Project includes
 #include "Timer.h"
+#include "FrameBuffer.h"
+#if !defined(HEADLESS_ONLY)
+#include "SDLFrameBuffer.h"
+#endif
+#include "Benchmark.h"
+#include "Trace.h"
 #include "Renderer.h"
 #include "Scene.h"
 
 using namespace dae;
 
-void ShutDown(SDL_Window* pWindow)
+// Simulated time per headless frame, the same step the benchmark uses
+constexpr float g_HeadlessTimeStep{ 1.f / 30.f };
+
+// Every scene CreateScene knows, in benchmark order
+const char* g_SceneNames[]{ "W1", "W2", "W3", "W4", "W4_TestScene", "W4_ReferenceScene", "W4_BunnyScene" };
+
+struct LaunchOptions
 {
-	SDL_DestroyWindow(pWindow);
-	SDL_Quit();
+	bool headless{ false };
+	bool benchmark{ false };
+	// Empty picks the default of the mode: the reference scene, or every scene when benchmarking
+	std::string sceneName{};
+	int width{ 640 };
+	int height{ 480 };
+	// 0 picks the default of the mode
+	int nrFrames{ 0 };
+	std::string outputPath{};
+	Renderer::LightingMode lightingMode{ Renderer::LightingMode::Combined };
+	ResolveSettings resolveSettings{};
+	// Empty records no timeline
+	std::string tracePath{};
+};
+
+void PrintUsage()
+{
+	std::cout << "Usage: RayTracer [--headless | --benchmark] [--scene <name>] [--width <pixels>] [--height <pixels>] [--frames <count>] [--output <path>] [--lighting <mode>] [--tonemap <name>] [--exposure <value>] [--srgb] [--trace <file.json>]\n"
+		<< "  --headless   Render the frames (default 1) without a window, save the last one to the output file (default RayTracing_Buffer.bmp) and exit\n"
+		<< "  --benchmark  Render the frames (default 60) of the scene, or of every scene, along a fixed camera path\n"
+		<< "               and write the frame time statistics to <output>.json and <output>.csv (default benchmark)\n"
+		<< "  Scenes: W1, W2, W3, W4, W4_TestScene, W4_ReferenceScene, W4_BunnyScene or the path of a .scene file\n"
+		<< "  --tonemap    MaxToOne (default), Reinhard or ACES, applied after multiplying by the exposure (default 1)\n"
+		<< "  --srgb       Encode the output with the sRGB curve instead of writing linear values\n"
+		<< "  --trace      Record a timeline of the frame phases and render tiles for chrome://tracing or ui.perfetto.dev\n"
+		<< "  Lighting modes: ObservedArea, Radiance, BRDF, Combined, HeatmapCycles, HeatmapTests (needs RAY_STATISTICS)\n";
 }
 
-int main(int argc, char* args[])
+bool ParseLightingMode(const std::string& name, Renderer::LightingMode& lightingMode)
 {
-	// Dot & Cross test
-#if 0
-	float dotResult{};
-	dotResult = Vector3::Dot(Vector3::UnitX, Vector3::UnitX);  // (1) Same Direction
-	dotResult = Vector3::Dot(Vector3::UnitX, -Vector3::UnitX); // (-1) Opposite Direction
-	dotResult = Vector3::Dot(Vector3::UnitX, Vector3::UnitY); // (0) Perpendicular
+	for (int i{ 0 }; i < static_cast<int>(Renderer::LightingMode::Count); ++i)
+	{
+		const auto currentMode{ static_cast<Renderer::LightingMode>(i) };
+		if (name == Renderer::GetLightingModeName(currentMode))
+		{
+#ifndef RAY_STATISTICS
+			// Nothing counts the tests, the heatmap would stay empty
+			if (currentMode == Renderer::LightingMode::HeatmapTests)
+			{
+				std::cout << name << " needs a build with RAY_STATISTICS\n";
+				return false;
+			}
+#endif
+			lightingMode = currentMode;
+			return true;
+		}
+	}
+	return false;
+}
 
-	Vector3 crossResult{}; //Left-Handed!
-	crossResult = Vector3::Cross(Vector3::UnitZ, Vector3::UnitX); //(0,1,0) UnitY
-	crossResult = Vector3::Cross(Vector3::UnitX, Vector3::UnitZ); //(0,-1,0) -UnitY
+bool ParseToneMapper(const std::string& name, ToneMapper& toneMapper)
+{
+	for (int i{ 0 }; i < static_cast<int>(ToneMapper::Count); ++i)
+	{
+		const auto currentToneMapper{ static_cast<ToneMapper>(i) };
+		if (name == ToneMapping::GetToneMapperName(currentToneMapper))
+		{
+			toneMapper = currentToneMapper;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ParseArguments(int argc, char* args[], LaunchOptions& options)
+{
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		const bool hasValue{ i + 1 < argc };
+
+		if (argument == "--headless") options.headless = true;
+		else if (argument == "--benchmark") options.benchmark = true;
+		else if (argument == "--scene" && hasValue) options.sceneName = args[++i];
+		else if (argument == "--width" && hasValue) options.width = std::atoi(args[++i]);
+		else if (argument == "--height" && hasValue) options.height = std::atoi(args[++i]);
+		else if (argument == "--frames" && hasValue)
+		{
+			// Leaving nrFrames at 0 picks the default, an explicit count has to render at least one frame
+			options.nrFrames = std::atoi(args[++i]);
+			if (options.nrFrames <= 0)
+			{
+				std::cout << "Frame count has to be positive\n";
+				return false;
+			}
+		}
+		else if (argument == "--output" && hasValue) options.outputPath = args[++i];
+		else if (argument == "--trace" && hasValue) options.tracePath = args[++i];
+		else if (argument == "--lighting" && hasValue && ParseLightingMode(args[i + 1], options.lightingMode)) ++i;
+		else if (argument == "--tonemap" && hasValue && ParseToneMapper(args[i + 1], options.resolveSettings.toneMapper)) ++i;
+		else if (argument == "--exposure" && hasValue) options.resolveSettings.exposure = static_cast<float>(std::atof(args[++i]));
+		else if (argument == "--srgb") options.resolveSettings.sRGB = true;
+		else
+		{
+			std::cout << "Unknown or incomplete argument: " << argument << '\n';
+			return false;
+		}
+	}
+
+	if (options.width <= 0 || options.height <= 0)
+	{
+		std::cout << "Resolution has to be positive\n";
+		return false;
+	}
+	if (options.resolveSettings.exposure <= 0.f)
+	{
+		std::cout << "Exposure has to be positive\n";
+		return false;
+	}
+	return true;
+}
+
+Scene* CreateSceneByName(const std::string& sceneName)
+{
+	if (sceneName == "W1") return new Scene_W1();
+	if (sceneName == "W2") return new Scene_W2();
+	if (sceneName == "W3") return new Scene_W3();
+	if (sceneName == "W4") return new Scene_W4();
+	if (sceneName == "W4_TestScene") return new Scene_W4_TestScene();
+	if (sceneName == "W4_ReferenceScene") return new Scene_W4_ReferenceScene();
+	if (sceneName == "W4_BunnyScene") return new Scene_W4_BunnyScene();
+	if (sceneName.ends_with(".scene")) return new Scene_File(sceneName);
+	return nullptr;
+}
+
+// Returns an initialized scene, nullptr for unknown names and scene files that did not load
+Scene* CreateScene(const std::string& sceneName)
+{
+	Scene* pScene{ CreateSceneByName(sceneName) };
+	if (!pScene) return nullptr;
+
+	pScene->Initialize();
+	const auto pSceneFile{ dynamic_cast<Scene_File*>(pScene) };
+	if (pSceneFile && !pSceneFile->IsLoaded())
+	{
+		delete pScene;
+		return nullptr;
+	}
+	return pScene;
+}
+
+void StopTrace(const LaunchOptions& options)
+{
+	if (options.tracePath.empty()) return;
+
+	if (Trace::Stop(options.tracePath))
+		std::cout << "Saved trace " << options.tracePath << std::endl;
+	else
+		std::cout << "Could not write " << options.tracePath << std::endl;
+}
+
+int RunHeadless(const LaunchOptions& options, Scene* pScene)
+{
+	const auto pTimer = new Timer();
+	// Animated scenes are driven by simulated time, so the saved image does not depend on how fast the machine is
+	pTimer->SetFixedTimeStep(g_HeadlessTimeStep);
+	const auto pFrameBuffer = new MemoryFrameBuffer(options.width, options.height);
+	const auto pRenderer = new Renderer(pFrameBuffer);
+	pRenderer->SetLightingMode(options.lightingMode);
+	pRenderer->SetResolveSettings(options.resolveSettings);
+
+	// The timer runs on the fixed step, the wall clock measures the frames
+	const auto renderStart{ std::chrono::steady_clock::now() };
+	[[maybe_unused]] float lastFrameSeconds{};
+	pTimer->Start();
+	for (int frame{ 0 }; frame < options.nrFrames; ++frame)
+	{
+		TRACE_ZONE_ARG("Frame", frame);
+		const auto frameStart{ std::chrono::steady_clock::now() };
+		{
+			TRACE_ZONE("Scene::Update");
+			pScene->Update(pTimer);
+		}
+		{
+			TRACE_ZONE("Renderer::Render");
+			pRenderer->Render(pScene);
+		}
+		pTimer->Update();
+		lastFrameSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - frameStart).count();
+	}
+	pTimer->Stop();
+	const float totalSeconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - renderStart).count() };
+
+	std::cout << "Rendered " << options.nrFrames << " frame(s) of " << options.sceneName
+		<< " at " << options.width << 'x' << options.height
+		<< " in " << totalSeconds << " s (" << totalSeconds * 1000.f / options.nrFrames << " ms/frame)\n";
+#ifdef RAY_STATISTICS
+	std::cout << "Last frame: " << Statistics::FormatReport(pRenderer->GetStatisticsLastFrame(), lastFrameSeconds) << '\n';
 #endif
 
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	const bool isSaved{ pRenderer->SaveBufferToImage(options.outputPath) };
+	if (isSaved)
+		std::cout << "Saved " << options.outputPath << std::endl;
+	else
+		std::cout << "Could not write " << options.outputPath << std::endl;
 
+	delete pRenderer;
+	delete pFrameBuffer;
+	delete pTimer;
+	return isSaved ? 0 : 1;
+}
+
+int RunBenchmark(const LaunchOptions& options)
+{
+	Benchmark::Settings settings{};
+	settings.width = options.width;
+	settings.height = options.height;
+	settings.nrFrames = options.nrFrames;
+	Benchmark benchmark{ settings };
+
+	std::vector<std::string> sceneNames{};
+	if (options.sceneName.empty()) sceneNames.assign(std::begin(g_SceneNames), std::end(g_SceneNames));
+	else sceneNames.push_back(options.sceneName);
+
+	for (const std::string& sceneName : sceneNames)
+	{
+		const auto pScene = CreateScene(sceneName);
+		if (!pScene)
+		{
+			std::cout << "Unknown or invalid scene: " << sceneName << '\n';
+			return 1;
+		}
+
+		std::cout << "Benchmarking " << sceneName << "...\n";
+		benchmark.RunScene(sceneName, pScene);
+		delete pScene;
+	}
+
+	std::cout << "**BENCHMARK FINISHED**\n";
+	benchmark.PrintSummary();
+
+	const bool isSaved{ benchmark.SaveJSON(options.outputPath + ".json") && benchmark.SaveCSV(options.outputPath + ".csv") };
+	if (isSaved)
+		std::cout << "Saved " << options.outputPath << ".json and " << options.outputPath << ".csv" << std::endl;
+	else
+		std::cout << "Could not write " << options.outputPath << ".json/.csv" << std::endl;
+	return isSaved ? 0 : 1;
+}
+
+#if !defined(HEADLESS_ONLY)
+void ShutDown(SDL_Window* pWindow)
+{
+	SDL_DestroyWindow(pWindow);
+	SDL_Quit();
+}
+
+// The renderer itself has no input, the window maps the function keys onto its settings
+void HandleRendererKey(SDL_Scancode scancode, Renderer* pRenderer, Timer* pTimer)
+{
+	switch (scancode)
+	{
+	case SDL_SCANCODE_F2:
+		pRenderer->ToggleShadows();
+		break;
+	case SDL_SCANCODE_F3:
+		pRenderer->CycleLightingMode();
+		break;
+	case SDL_SCANCODE_F4:
+		pRenderer->TogglePacketTracing();
+		break;
+	case SDL_SCANCODE_F5:
+		pRenderer->ToggleAccumulation();
+		break;
+	case SDL_SCANCODE_F6:
+		pTimer->StartBenchmark();
+		break;
+	case SDL_SCANCODE_F7:
+		pRenderer->CycleToneMapper();
+		break;
+	case SDL_SCANCODE_F8:
+		pRenderer->ToggleSRGB();
+		break;
+	default:
+		break;
+	}
+}
+
+int RunWindowed(const LaunchOptions& options, Scene* pScene)
+{
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
 
-	const uint32_t width = 640;
-	const uint32_t height = 480;
-
 	SDL_Window* pWindow = SDL_CreateWindow(
 		"RayTracer - Messely, Rei (2DAE15N)",
 		SDL_WINDOWPOS_UNDEFINED,
 		SDL_WINDOWPOS_UNDEFINED,
-		width, height, 0);
+		options.width, options.height, 0);
 
 	if (!pWindow)
 		return 1;
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
-
-	const auto pScene = new Scene_W4_ReferenceScene();
-	pScene->Initialize();
+	const auto pFrameBuffer = new SDLFrameBuffer(pWindow);
+	if (!pFrameBuffer->IsValid())
+	{
+		std::cout << "Could not create the window surface: " << SDL_GetError() << '\n';
+		delete pFrameBuffer;
+		delete pTimer;
+		ShutDown(pWindow);
+		return 1;
+	}
+	const auto pRenderer = new Renderer(pFrameBuffer);
+	pRenderer->SetLightingMode(options.lightingMode);
+	pRenderer->SetResolveSettings(options.resolveSettings);
 
 	//Start loop
 	pTimer->Start();
@@ -67,6 +350,8 @@ int main(int argc, char* args[])
 	bool takeScreenshot = false;
 	while (isLooping)
 	{
+		TRACE_ZONE("Frame");
+
 		//--------- Get input events ---------
 		SDL_Event e;
 		while (SDL_PollEvent(&e))
@@ -80,29 +365,47 @@ int main(int argc, char* args[])
 				if(e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
 				break;
+			case SDL_KEYDOWN:
+				// Held keys repeat, only the first press toggles
+				if (!e.key.repeat)
+					HandleRendererKey(e.key.keysym.scancode, pRenderer, pTimer);
+				break;
 			}
 		}
 
 		//--------- Update ---------
-		pScene->Update(pTimer);
+		{
+			TRACE_ZONE("Scene::Update");
+			pScene->Update(pTimer);
+		}
 
 		//--------- Render ---------
-		pRenderer->Render(pScene);
-		pRenderer->Update(pTimer);
+		{
+			TRACE_ZONE("Renderer::Render");
+			pRenderer->Render(pScene);
+		}
+		// A converged image only needs to be shown, do not spin on it
+		if (pRenderer->IsConverged()) SDL_Delay(10);
 
 		//--------- Timer ---------
-		pTimer->Update();
+		{
+			TRACE_ZONE("Timer::Update");
+			pTimer->Update();
+		}
 		printTimer += pTimer->GetElapsed();
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+#ifdef RAY_STATISTICS
+			std::cout << Statistics::FormatReport(pRenderer->GetStatisticsLastFrame(), pTimer->GetElapsed()) << std::endl;
+#endif
 		}
 
 		//Save screenshot after full render
 		if (takeScreenshot)
 		{
-			if (!pRenderer->SaveBufferToImage())
+			if (pRenderer->SaveBufferToImage(options.outputPath))
 				std::cout << "Screenshot saved!" << std::endl;
 			else
 				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
@@ -112,10 +415,74 @@ int main(int argc, char* args[])
 	pTimer->Stop();
 
 	//Shutdown "framework"
-	delete pScene;
 	delete pRenderer;
+	delete pFrameBuffer;
 	delete pTimer;
 
 	ShutDown(pWindow);
 	return 0;
+}
+#endif
+
+int main(int argc, char* args[])
+{
+	// Dot & Cross test
+#if 0
+	float dotResult{};
+	dotResult = Vector3::Dot(Vector3::UnitX, Vector3::UnitX);  // (1) Same Direction
+	dotResult = Vector3::Dot(Vector3::UnitX, -Vector3::UnitX); // (-1) Opposite Direction
+	dotResult = Vector3::Dot(Vector3::UnitX, Vector3::UnitY); // (0) Perpendicular
+
+	Vector3 crossResult{}; //Left-Handed!
+	crossResult = Vector3::Cross(Vector3::UnitZ, Vector3::UnitX); //(0,1,0) UnitY
+	crossResult = Vector3::Cross(Vector3::UnitX, Vector3::UnitZ); //(0,-1,0) -UnitY
+#endif
+
+	LaunchOptions options{};
+	if (!ParseArguments(argc, args, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+#if defined(HEADLESS_ONLY)
+	if (!options.headless && !options.benchmark)
+	{
+		std::cout << "Built without a window, pass --headless or --benchmark\n";
+		return 1;
+	}
+#endif
+
+	Trace::SetThreadName("Main");
+	if (!options.tracePath.empty()) Trace::Start();
+
+	if (options.benchmark)
+	{
+		if (options.nrFrames == 0) options.nrFrames = 60;
+		if (options.outputPath.empty()) options.outputPath = "benchmark";
+		const int benchmarkResult{ RunBenchmark(options) };
+		StopTrace(options);
+		return benchmarkResult;
+	}
+
+	if (options.nrFrames == 0) options.nrFrames = 1;
+	if (options.outputPath.empty()) options.outputPath = "RayTracing_Buffer.bmp";
+	if (options.sceneName.empty()) options.sceneName = "W4_ReferenceScene";
+
+	const auto pScene = CreateScene(options.sceneName);
+	if (!pScene)
+	{
+		std::cout << "Unknown or invalid scene: " << options.sceneName << '\n';
+		PrintUsage();
+		return 1;
+	}
+
+#if defined(HEADLESS_ONLY)
+	const int result{ RunHeadless(options, pScene) };
+#else
+	const int result{ options.headless ? RunHeadless(options, pScene) : RunWindowed(options, pScene) };
+#endif
+	StopTrace(options);
+
+	delete pScene;
+	return result;
 }
\ No newline at end of file